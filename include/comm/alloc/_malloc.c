@@ -531,7 +531,12 @@ MAX_RELEASE_CHECK_RATE   default: 4095 unless not HAVE_MMAP
 // modules) are possible
 #define FOOTERS 1
 
+#ifdef _MSC_VER
 void __debugbreak();
+#else
+#include <signal.h>
+#define __debugbreak() raise(SIGTRAP)
+#endif
 void abort_routine();
 
 #ifdef _DEBUG
@@ -1351,6 +1356,14 @@ DLMALLOC_EXPORT void* mspace_malloc(mspace msp, size_t bytes);
 
 DLMALLOC_EXPORT void* mspace_malloc_virtual(mspace msp, size_t bytes);
 
+/*
+  mspace_malloc_virtual_flags behaves as mspace_malloc_virtual, with
+  MSPACE_VIRTUAL_HUGEPAGES requesting transparent huge pages for the
+  reserved range and MSPACE_VIRTUAL_HUGETLB requesting explicit huge
+  pages (falls back to normal pages when no huge pages are available).
+*/
+DLMALLOC_EXPORT void* mspace_malloc_virtual_flags(mspace msp, size_t bytes, int flags);
+
 /*
   mspace_free behaves as free, but operates within
   the given space.
@@ -1425,11 +1438,31 @@ DLMALLOC_EXPORT struct mallinfo mspace_mallinfo(mspace msp);
 DLMALLOC_EXPORT size_t mspace_usable_size(const void* mem);
 
 /*
-  malloc_virtual_size(void* p) returns virtual block size if it was
-  previously allocated via mspace_malloc_virtual, otherwise 0
+  malloc_virtual_size(void* p) returns virtual block size (the usable size
+  it can grow to in place) if it was previously allocated via
+  mspace_malloc_virtual, otherwise 0
 */
 DLMALLOC_EXPORT size_t mspace_virtual_size(const void* mem);
 
+/*
+  mspace_virtual_prefault commits and populates the first bytes of
+  a virtual block, returns the number of bytes prefaulted
+*/
+DLMALLOC_EXPORT size_t mspace_virtual_prefault(void* mem, size_t bytes);
+
+/*
+  mspace_virtual_release returns the committed pages of a virtual block
+  past the first keep bytes to the system (MADV_DONTNEED/MEM_DECOMMIT),
+  the address space stays reserved. Returns the number of bytes released
+*/
+DLMALLOC_EXPORT size_t mspace_virtual_release(void* mem, size_t keep);
+
+/*
+  mspace_virtual_resident returns the number of bytes of a virtual block
+  currently backed by physical memory (committed bytes on win32)
+*/
+DLMALLOC_EXPORT size_t mspace_virtual_resident(const void* mem);
+
 /*
   mspace_malloc_stats behaves as malloc_stats, but reports
   properties of the given space.
@@ -3934,20 +3967,62 @@ static void* mmap_alloc(mstate m, size_t nb) {
   return 0;
 }
 
+/* Reserve address space for a virtual memory block, committing commit_size bytes */
+
+#define VIRTUAL_HUGEPAGE_SIZE  ((size_t)2U << 20)
+
+#ifndef WIN32
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+static void* virtual_mmap(size_t size, size_t commit_size, int flags) {
+#ifdef MAP_ANONYMOUS
+  void* mm = MFAIL;
+  (void)commit_size;
+#ifdef MAP_HUGETLB
+  if (flags & MSPACE_VIRTUAL_HUGETLB)
+    /* without MAP_NORESERVE, so it fails here instead of SIGBUS on touch when the pool is short */
+    mm = mmap(0, size, MMAP_PROT, MMAP_FLAGS|MAP_HUGETLB, -1, 0);
+#endif /* MAP_HUGETLB */
+  if (mm == MFAIL) {
+    /* address space only, pages are backed on first touch */
+    mm = mmap(0, size, MMAP_PROT, MMAP_FLAGS|MAP_NORESERVE, -1, 0);
+#ifdef MADV_HUGEPAGE
+    if (mm != MFAIL && (flags & MSPACE_VIRTUAL_HUGEPAGES))
+      madvise(mm, size, MADV_HUGEPAGE);
+#endif /* MADV_HUGEPAGE */
+  }
+  return mm;
+#else /* MAP_ANONYMOUS */
+  (void)flags;
+  return CALL_DIRECT_MMAP(size, commit_size, 0);
+#endif /* MAP_ANONYMOUS */
+}
+#else /* WIN32 */
+/* large pages on win32 need SeLockMemoryPrivilege and cannot be committed
+   incrementally, so the huge page flags are ignored there */
+#define virtual_mmap(s,cs,f) CALL_DIRECT_MMAP(s,cs,0)
+#endif /* WIN32 */
+
 /* Alloc a reserved virtual memory block.
    prev_foot contains the reserved memory + alignment offset on lower bits
 */
 
-static void* mmap_alloc_virtual(mstate m, size_t nb) {
-  size_t mmsize = mmap_align(nb + /*m->modalign +*/ TWO_SIZE_T_SIZES + CHUNK_ALIGN_MASK);
+static void* mmap_alloc_virtual(mstate m, size_t nb, int flags) {
+  /* room for the chunk grown to nb bytes, its overhead and alignment offset */
+  size_t mmsize = mmap_align(request2size(nb) + /*m->modalign +*/ MMAP_CHUNK_OVERHEAD + CHUNK_ALIGN_MASK);
   //if (m->footprint_limit != 0) {
   //  size_t fp = m->footprint + mmsize;
   //  if (fp <= m->footprint || fp > m->footprint_limit)
   //    return 0;
   //}
+  if (flags & MSPACE_VIRTUAL_HUGETLB)
+    /* hugetlb mappings must be unmapped in whole huge pages */
+    mmsize = (mmsize + VIRTUAL_HUGEPAGE_SIZE - SIZE_T_ONE) & ~(VIRTUAL_HUGEPAGE_SIZE - SIZE_T_ONE);
   if (mmsize > nb) {     /* Check for wrap around 0 */
     size_t commit_size = mparams.page_size;
-    char* mm = (char*)(CALL_DIRECT_MMAP(mmsize, commit_size, 0));
+    char* mm = (char*)(virtual_mmap(mmsize, commit_size, flags));
     if (mm != CMFAIL) {
       size_t offset = align_offset(chunk2mem(mm), m->modalign);
       size_t psize = mmsize /*- offset - m->modalign*/;// - MMAP_FOOT_PAD;
@@ -5628,7 +5703,17 @@ void* mspace_malloc_virtual(mspace msp, size_t bytes) {
         return 0;
     }
 
-    return mmap_alloc_virtual(ms, bytes);
+    return mmap_alloc_virtual(ms, bytes, 0);
+}
+
+void* mspace_malloc_virtual_flags(mspace msp, size_t bytes, int flags) {
+    mstate ms = (mstate)msp;
+    if (!ok_magic(ms)) {
+        USAGE_ERROR_ACTION(ms, ms);
+        return 0;
+    }
+
+    return mmap_alloc_virtual(ms, bytes, flags);
 }
 
 /*
@@ -6147,12 +6232,112 @@ size_t mspace_virtual_size(const void* mem) {
     if (flag4inuse(p)) {
       size_t psize = mmap_align_down(p->prev_foot);
       size_t offset = p->prev_foot - psize;
-      return psize - offset - MMAP_CHUNK_OVERHEAD;
+      return ((psize - offset - MMAP_CHUNK_OVERHEAD) & ~CHUNK_ALIGN_MASK) - CHUNK_OVERHEAD;
     }
   }
   return 0;
 }
 
+size_t mspace_virtual_prefault(void* mem, size_t bytes) {
+  size_t vsize = mspace_virtual_size(mem);
+  if (vsize == 0)
+    return 0;
+  if (bytes > vsize)
+    bytes = vsize;
+
+  /* commit the range first, usable size grows accordingly */
+  if (mspace_realloc_in_place(mem, bytes) == 0)
+    return 0;
+
+  {
+    size_t ps = mparams.page_size;
+    char* base = (char*)((size_t)mem2chunk(mem) & ~(ps - SIZE_T_ONE));
+    char* end = (char*)mem + bytes;
+#if !defined(WIN32) && defined(MADV_POPULATE_WRITE)
+    if (madvise(base, end - base, MADV_POPULATE_WRITE) == 0)
+      return bytes;
+#endif /* MADV_POPULATE_WRITE */
+    /* touch each page without altering its content */
+    for (; base < end; base += ps) {
+      volatile char* c = base;
+      *c = *c;
+    }
+  }
+  return bytes;
+}
+
+size_t mspace_virtual_release(void* mem, size_t keep) {
+  if (mem != 0) {
+    mchunkptr p = mem2chunk(mem);
+    if (flag4inuse(p)) {
+      size_t ps = mparams.page_size;
+      size_t nb = request2size(keep);
+      char* from = (char*)(((size_t)p + nb + MMAP_CHUNK_OVERHEAD + ps - SIZE_T_ONE) & ~(ps - SIZE_T_ONE));
+      char* end = (char*)(((size_t)p + chunksize(p) + MMAP_CHUNK_OVERHEAD + ps - SIZE_T_ONE) & ~(ps - SIZE_T_ONE));
+      size_t commit_size;
+
+      if (keep >= MAX_REQUEST || from >= end)
+        return 0;
+
+#ifndef WIN32
+      if (madvise(from, end - from, MADV_DONTNEED) != 0)
+        return 0;
+#else /* WIN32 */
+      if (VirtualFree(from, end - from, MEM_DECOMMIT) == 0)
+        return 0;
+#endif /* WIN32 */
+
+      /* decommitted pages get committed again by mspace_realloc_in_place */
+      commit_size = ((size_t)(from - (char*)p) - MMAP_CHUNK_OVERHEAD) & ~CHUNK_ALIGN_MASK;
+      p->head = commit_size | (p->head & FLAG_BITS);
+      return end - from;
+    }
+  }
+  return 0;
+}
+
+size_t mspace_virtual_resident(const void* mem) {
+  size_t resident = 0;
+  if (mem != 0) {
+    mchunkptr p = mem2chunk(mem);
+    if (flag4inuse(p)) {
+      size_t ps = mparams.page_size;
+      char* base = (char*)((size_t)p & ~(ps - SIZE_T_ONE));
+      char* end = (char*)(((size_t)p + chunksize(p) + MMAP_CHUNK_OVERHEAD + ps - SIZE_T_ONE) & ~(ps - SIZE_T_ONE));
+#ifndef WIN32
+#if defined(__APPLE__) || defined(__FreeBSD__)
+      char vec[1024];
+#else
+      unsigned char vec[1024];
+#endif
+      while (base < end) {
+        size_t n = (end - base) / ps;
+        size_t i;
+        if (n > sizeof(vec))
+          n = sizeof(vec);
+        if (mincore(base, n * ps, vec) != 0)
+          break;
+        for (i = 0; i < n; ++i)
+          resident += (vec[i] & 1) ? ps : 0;
+        base += n * ps;
+      }
+#else /* WIN32 */
+      /* reports committed pages, the working set would need psapi */
+      MEMORY_BASIC_INFORMATION minfo;
+      while (base < end && VirtualQuery(base, &minfo, sizeof(minfo)) != 0) {
+        char* rend = (char*)minfo.BaseAddress + minfo.RegionSize;
+        if (rend > end)
+          rend = end;
+        if (minfo.State == MEM_COMMIT)
+          resident += rend - base;
+        base = rend;
+      }
+#endif /* WIN32 */
+    }
+  }
+  return resident;
+}
+
 mspace mspace_from_ptr(const void* mem) {
     if (mem) {
         mchunkptr p  = mem2chunk(mem);
@@ -595,12 +595,19 @@ struct mallinfo mspace_mallinfo(mspace msp);
 */
 int mspace_mallopt(int, int);
 
+/*
+  Flags for mspace_malloc_virtual_flags
+*/
+#define MSPACE_VIRTUAL_HUGEPAGES  1   /* transparent huge pages hint (madvise) */
+#define MSPACE_VIRTUAL_HUGETLB    2   /* explicit huge pages (MAP_HUGETLB), falls back to normal pages */
+
 /*
   The following operate identically to their malloc counterparts
   but operate only for the given mspace argument
 */
 void* mspace_malloc(mspace msp, size_t bytes);
 void* mspace_malloc_virtual(mspace msp, size_t bytes);
+void* mspace_malloc_virtual_flags(mspace msp, size_t bytes, int flags);
 void mspace_free(/*mspace msp,*/ void* mem);
 void* mspace_calloc(mspace msp, size_t n_elements, size_t elem_size);
 void* mspace_realloc(mspace msp, void* mem, size_t newsize);
@@ -613,6 +620,9 @@ void** mspace_independent_comalloc(mspace msp, size_t n_elements,
 size_t mspace_bulk_free(mspace msp, void**, size_t n_elements);
 size_t mspace_usable_size(const void* mem);
 size_t mspace_virtual_size(const void* mem);
+size_t mspace_virtual_prefault(void* mem, size_t bytes);
+size_t mspace_virtual_release(void* mem, size_t keep);
+size_t mspace_virtual_resident(const void* mem);
 mspace mspace_from_ptr(const void* mem);
 void mspace_malloc_stats(mspace msp);
 int mspace_trim(mspace msp, size_t pad);
@@ -95,9 +95,10 @@ struct comm_array_allocator
     }
 
     ///Typed array reserve
+    //@param flags MSPACE_VIRTUAL_* reservation flags
     template<class T>
-    static T* reserve(uints n, mspace m = 0) {
-        return (T*)reserve(n, sizeof(T), &typeid(T[]), m);
+    static T* reserve(uints n, mspace m = 0, int flags = 0) {
+        return (T*)reserve(n, sizeof(T), &typeid(T[]), m, flags);
     }
 
     ///Typed array alloc
@@ -117,6 +118,7 @@ struct comm_array_allocator
         if (vs > 0) {
             //reserved virtual memory, will be reallocated in-place
             T* pn = (T*)realloc_in_place(p, n, sizeof(T), &typeid(T[]));
+            if (!pn) throw std::bad_alloc();
             return pn;
         }
 
@@ -165,12 +167,14 @@ struct comm_array_allocator
         uints n,
         uints elemsize,
         const std::type_info* tracking = 0,
-        mspace m = 0
+        mspace m = 0,
+        int flags = 0
     )
     {
-        uints* p = (uints*)::mspace_malloc_virtual(
+        uints* p = (uints*)::mspace_malloc_virtual_flags(
             m ? m : SINGLETON(comm_array_mspace).msp,
-            sizeof(uints) + n * elemsize);
+            sizeof(uints) + n * elemsize,
+            flags);
 
         dbg_memtrack_alloc(tracking, ::mspace_usable_size(p));
 
@@ -288,6 +292,11 @@ struct comm_array_allocator
             if (nalloc < 2 * n)
                 nalloc = 2 * n;
 
+            //virtual reservation can't grow past the reserved space
+            uints vs = reserved_size(p);
+            if (vs && nalloc > nto && nalloc * elemsize > vs)
+                nalloc = nto > vs / elemsize ? nto : vs / elemsize;
+
             np = realloc(p, nalloc, elemsize, tracking, m);
         }
 
@@ -302,9 +311,28 @@ struct comm_array_allocator
             : 0;
     }
 
-    //@return size of virtual memory, if the block was created using reserve(), else 0
+    //@return size of virtual memory available for items, if the block was created using reserve(), else 0
     static uints reserved_size(const void* p) {
-        return p ? ::mspace_virtual_size((const uints*)p - 1) : 0;
+        uints vs = p ? ::mspace_virtual_size((const uints*)p - 1) : 0;
+        return vs ? vs - sizeof(uints) : 0;
+    }
+
+    //@return number of bytes of a reserved block backed by physical memory
+    static uints resident_size(const void* p) {
+        return p ? ::mspace_virtual_resident((const uints*)p - 1) : 0;
+    }
+
+    ///Commit and populate the first \a bytes of a block created using reserve()
+    //@return number of bytes prefaulted
+    static uints prefault(const void* p, uints bytes) {
+        uints n = p ? ::mspace_virtual_prefault((uints*)p - 1, sizeof(uints) + bytes) : 0;
+        return n ? n - sizeof(uints) : 0;
+    }
+
+    ///Return pages of a block created using reserve() past the first \a keep bytes to the system
+    //@return number of bytes released
+    static uints release(const void* p, uints keep) {
+        return p ? ::mspace_virtual_release((uints*)p - 1, sizeof(uints) + keep) : 0;
     }
 
     static uints count(const void* p) {
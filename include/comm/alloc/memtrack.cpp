@@ -35,10 +35,9 @@
  * ***** END LICENSE BLOCK ***** */
 
 #include "memtrack.h"
-#include "../hash/hashkeyset.h"
+#include "../hash/concurrent_hashkeyset.h"
 #include "../singleton.h"
 #include "../atomic/atomic.h"
-#include "../sync/mutex.h"
 
 #include "../binstream/filestream.h"
 
@@ -99,23 +98,25 @@ struct hash_memtrack {
     uint operator()(size_t x) const { return (uint)x; }
 };
 
-typedef hash_keyset<memtrack_imp, _Select_Copy<memtrack_imp, size_t>, hash_memtrack>
+typedef concurrent_hash_keyset<memtrack_imp, _Select_Copy<memtrack_imp, size_t>, hash_memtrack>
 memtrack_hash_t;
 
+///Set while the thread holds a lock of the tracking table
+//@note the table allocates and frees its own memory through tracked allocators, nested calls are not tracked
+static thread_local bool memtrack_inside = false;
+
 ///
 struct memtrack_registrar
 {
     volatile bool running = false;
 
     memtrack_hash_t* hash = 0;
-    comm_mutex* mux = 0;
 
     bool enabled = default_enabled;
     bool ready = false;
 
     memtrack_registrar()
     {
-        mux = new comm_mutex(500, false);
         hash = new memtrack_hash_t;
 
         ready = true;
@@ -128,68 +129,59 @@ struct memtrack_registrar
     ///Track allocation
     virtual void alloc(const std::type_info* tracking, size_t size)
     {
-        static bool inside = false;
-        if (inside)
+        if (memtrack_inside)
             return;     //avoid stack overlow from hashmap
 
         const char* name = tracking ? tracking->name() : "unknown";
 
-        GUARDTHIS(*mux);
-        inside = true;
-        memtrack* val = hash->find_or_insert_value_slot((size_t)name);
-        inside = false;
-
-        val->name = name;
-
-        ++val->nallocs;
-        ++val->ncurallocs;
-        ++val->nlifeallocs;
-        val->size += size;
-        val->cursize += size;
-        val->lifesize += size;
+        memtrack_inside = true;
+        hash->find_or_insert_value_slot((size_t)name, [&](memtrack_imp& val, bool isnew) {
+            val.name = name;
+
+            ++val.nallocs;
+            ++val.ncurallocs;
+            ++val.nlifeallocs;
+            val.size += size;
+            val.cursize += size;
+            val.lifesize += size;
+        });
+        memtrack_inside = false;
     }
 
     ///Track freeing
     virtual void free(const std::type_info* tracking, size_t size)
     {
-        const char* name = tracking ? tracking->name() : "unknown";
+        if (memtrack_inside)
+            return;     //freeing old buckets of the table while it grows, the shard is locked
 
-        GUARDTHIS(*mux);
-        memtrack_imp* val = const_cast<memtrack_imp*>(hash->find_value((size_t)name));
+        const char* name = tracking ? tracking->name() : "unknown";
 
-        if (val) {
-            //val->size -= size;
-            val->cursize -= size;
-            --val->ncurallocs;
-        }
+        memtrack_inside = true;
+        hash->update_value((size_t)name, [&](memtrack_imp& val) {
+            //val.size -= size;
+            val.cursize -= size;
+            --val.ncurallocs;
+        });
+        memtrack_inside = false;
     }
 
     virtual uint list(memtrack* dst, uint nmax, bool modified_only) const
     {
-        GUARDTHIS(*mux);
-        memtrack_hash_t::iterator ib = hash->begin();
-        memtrack_hash_t::iterator ie = hash->end();
-
         uint i = 0;
-        for (; ib != ie && i < nmax; ++ib) {
-            memtrack& p = *ib;
-            if (p.nallocs == 0 && modified_only)
-                continue;
+        hash->for_each_mutable([&](memtrack& p) {
+            if (i >= nmax || (p.nallocs == 0 && modified_only))
+                return;
 
             dst[i++] = p;
             p.nallocs = 0;
             p.size = 0;
-        }
+        });
 
         return i;
     }
 
     virtual void dump(const char* file, bool diff) const
     {
-        GUARDTHIS(*mux);
-        memtrack_hash_t::iterator ib = hash->begin();
-        memtrack_hash_t::iterator ie = hash->end();
-
         bofstream bof(file);
         if (!bof.is_open())
             return;
@@ -205,10 +197,9 @@ struct memtrack_registrar
         int64 totalsize = 0;
         size_t totalcount = 0;
 
-        for (; ib != ie; ++ib) {
-            memtrack& p = *ib;
+        hash->for_each([&](const memtrack& p) {
             if (diff ? (p.size == 0) : (p.cursize == 0))
-                continue;
+                return;
 
             ints size = diff ? p.size : ints(p.cursize);
             uint count = diff ? p.nallocs : p.ncurallocs;
@@ -226,7 +217,7 @@ struct memtrack_registrar
                 bof.xwrite_token_raw(buf);
                 buf.reset();
             }
-        }
+        });
 
         buf << "======== bytes | #alloc |  type ======\n";
         buf.append_num_metric(totalsize, 14);
@@ -249,20 +240,14 @@ struct memtrack_registrar
     }
 
     virtual uint count() const {
-        GUARDTHIS(*mux);
         return (uint)hash->size();
     }
 
     virtual void reset() {
-        GUARDTHIS(*mux);
-        memtrack_hash_t::iterator ib = hash->begin();
-        memtrack_hash_t::iterator ie = hash->end();
-
-        for (; ib != ie; ++ib) {
-            memtrack& p = *ib;
+        hash->for_each_mutable([](memtrack& p) {
             p.nallocs = 0;
             p.size = 0;
-        }
+        });
     }
 };
 
@@ -41,6 +41,8 @@
 #include "../namespace.h"
 #include "_malloc.h"
 #include <typeinfo>
+#include <utility>
+#include <new>
 
 namespace coid {
 
@@ -72,19 +72,33 @@ All objects are destroyed with the destruction of the allocator object.
 Safe to use from a single producer / single consumer threading mode, as long as the working set is
 reserved in advance.
 
+In the concurrent mode (slotalloc_mode::concurrent, linear only) items can be added and deleted from multiple
+threads without locking. The capacity is fixed by reserve()/reserve_virtual() that must be called before the
+concurrent use, and the main array, the bitmap and ext arrays are sized to it upfront, so nothing gets resized
+afterwards. Free slots are claimed with an atomic fetch_or on the bitmap word, starting at a word cached per
+thread (deletions update the cache too, so threads tend to reuse their own freed slots). Only push, push_construct,
+add, add_uninit, del, del_item and item accessors are safe to use concurrently; iteration, ranges and reset need
+external synchronization.
+
+Iteration cost is proportional to the number of live objects rather than to the capacity: besides the
+allocation bitmap there's a summary bitmap with one bit per 4096 slots (64 bitmap words), cleared when
+the block gets empty, and the bitmap itself is scanned 256 bits at a time (see find_nonzero_word).
+
 @param T array element type
 @param MODE see slotalloc_mode flags
 @param Es variadic types for optional parallel arrays which will be managed along with the main array
 **/
 template<class T, slotalloc_mode MODE = slotalloc_mode::base, class ...Es>
 class slotalloc_base
-    : protected slotalloc_detail::storage<MODE & slotalloc_mode::linear, MODE & slotalloc_mode::atomic, T>
+    : protected slotalloc_detail::storage<MODE & slotalloc_mode::linear, MODE & (slotalloc_mode::atomic | slotalloc_mode::concurrent), T>
     , protected slotalloc_detail::base<MODE & slotalloc_mode::versioning, MODE & slotalloc_mode::tracking, Es...>
+    , protected slotalloc_detail::concurrent_base<MODE & slotalloc_mode::concurrent>
 {
 protected:
 
     using tracker_t = slotalloc_detail::base<MODE & slotalloc_mode::versioning, MODE & slotalloc_mode::tracking, Es...>;
-    using storage_t = slotalloc_detail::storage<MODE & slotalloc_mode::linear, MODE & slotalloc_mode::atomic, T>;
+    using storage_t = slotalloc_detail::storage<MODE & slotalloc_mode::linear, MODE & (slotalloc_mode::atomic | slotalloc_mode::concurrent), T>;
+    using concurrent_t = slotalloc_detail::concurrent_base<MODE & slotalloc_mode::concurrent>;
 
     using extarray_t = typename tracker_t::extarray_t;
     using changeset_t = typename slotalloc_detail::changeset;
@@ -93,12 +107,18 @@ protected:
 
     static constexpr int MASK_BITS = 8 * sizeof(uints);
 
+    static constexpr uints SUMMARY_WORDS = 64;                          //< bitmap words covered by a summary bit
+    static constexpr uints SUMMARY_ITEMS = SUMMARY_WORDS * MASK_BITS;   //< slots covered by a summary bit
+
     static constexpr bool POOL = (MODE & slotalloc_mode::pool) != 0;
-    static constexpr bool ATOMIC = (MODE & slotalloc_mode::atomic) != 0;
+    static constexpr bool ATOMIC = (MODE & (slotalloc_mode::atomic | slotalloc_mode::concurrent)) != 0;
+    static constexpr bool CONCURRENT = (MODE & slotalloc_mode::concurrent) != 0;
     static constexpr bool TRACKING = (MODE & slotalloc_mode::tracking) != 0;
     static constexpr bool VERSIONING = (MODE & slotalloc_mode::versioning) != 0;
     static constexpr bool LINEAR = (MODE & slotalloc_mode::linear) != 0;
 
+    static_assert(!CONCURRENT || (LINEAR && !POOL && !TRACKING), "concurrent mode requires linear storage and can't be combined with pool or tracking modes");
+
 public:
 
     ///Construct slotalloc container
@@ -118,7 +138,9 @@ public:
     }
 
     ~slotalloc_base() {
-        if coid_constexpr_if(!POOL)
+        if coid_constexpr_if(CONCURRENT)
+            discard();
+        else if coid_constexpr_if(!POOL)
             reset();
     }
 
@@ -183,18 +205,25 @@ public:
     void swap(slotalloc_base& other) {
         this->swap_storage(other);
         this->swap_exts(other);
+        this->swap_hints(other);
 
         std::swap(_allocated, other._allocated);
+        std::swap(_summary, other._summary);
         std::swap(_count, other._count);
+        std::swap(_free_bound, other._free_bound);
     }
 
     friend void swap(slotalloc_base& a, slotalloc_base& b) {
         a.swap(b);
     }
 
+    ///Reserve memory for given number of items
+    //@note in the concurrent mode this sets the capacity, and has to be called before the concurrent use
     void reserve(uints nitems)
     {
         uints na = align_to_chunks(nitems, MASK_BITS);
+        if coid_constexpr_if(CONCURRENT)
+            nitems = na * MASK_BITS;
 
         if coid_constexpr_if (LINEAR) {
             this->_array.reserve(nitems, true);
@@ -204,26 +233,40 @@ public:
         }
 
         _allocated.reserve(na, true);
+        _summary.reserve(align_to_chunks(nitems, SUMMARY_ITEMS * MASK_BITS), true);
 
         extarray_reserve(nitems, reserve_mode::memory);
+
+        if coid_constexpr_if(CONCURRENT)
+            set_capacity(nitems);
     }
 
-    void reserve_virtual(uints nitems)
+    ///Reserve virtual address space for given number of items
+    //@param flags reservation options for the item array (linear mode)
+    //@param nprefault number of leading items to commit and prefault right away (linear mode)
+    //@note in the concurrent mode this sets the capacity, and has to be called before the concurrent use
+    void reserve_virtual(uints nitems, reserve_flags flags = reserve_flags::none, uints nprefault = 0)
     {
         uints na = align_to_chunks(nitems, MASK_BITS);
+        if coid_constexpr_if(CONCURRENT)
+            nitems = na * MASK_BITS;
 
         if coid_constexpr_if (LINEAR) {
             discard();
 
-            this->_array.reserve_virtual(nitems);
+            this->_array.reserve_virtual(nitems, flags, nprefault);
         }
         else {
             this->_pages.reserve_virtual(na);
         }
 
         _allocated.reserve_virtual(na);
+        _summary.reserve_virtual(align_to_chunks(nitems, SUMMARY_ITEMS * MASK_BITS));
 
         extarray_reserve(nitems, reserve_mode::virtual_space);
+
+        if coid_constexpr_if(CONCURRENT)
+            set_capacity(nitems);
     }
 
 
@@ -446,13 +489,14 @@ public:
         if coid_constexpr_if(!POOL)
             this->bump_version(id);
 
+        //destroy before releasing the slot, it can be reused by another thread right after
+        if coid_constexpr_if(!POOL)
+            p->~T();
+
         if (clear_bit(id))
             --_count;
         else
             DASSERTN(0);
-
-        if coid_constexpr_if(!POOL)
-            p->~T();
     }
 
     ///Delete object by id
@@ -466,15 +510,15 @@ public:
         if coid_constexpr_if(!POOL)
             this->bump_version(id);
 
-        if (clear_bit(id))
-            --_count;
-        else
-            DASSERTN(0);
-
         if coid_constexpr_if(!POOL) {
             T* p = ptr(id);
             p->~T();
         }
+
+        if (clear_bit(id))
+            --_count;
+        else
+            DASSERTN(0);
     }
 
 
@@ -590,6 +634,10 @@ public:
             }
         }
         _count -= clear_bitrange(item_id, n, _allocated.ptr());
+        update_summary_range(item_id, n);
+
+        if (item_id < _free_bound)
+            _free_bound = item_id;
     }
 
     ///Del range of objects
@@ -614,6 +662,28 @@ public:
             return this->_pages.size() * storage_t::PAGE_ITEMS;
     }
 
+    //@return bytes of virtual address space reserved by reserve_virtual, 0 if not used
+    uints reserved_bytes() const {
+        uints n = _allocated.reserved_virtual() + _summary.reserved_virtual();
+        if coid_constexpr_if (LINEAR)
+            n += this->_array.reserved_virtual();
+        else
+            n += this->_pages.reserved_virtual();
+        extarray_iterate([&n](const auto& a) { n += a.reserved_virtual(); });
+        return n;
+    }
+
+    //@return bytes of the virtual reservations currently backed by physical memory
+    uints resident_bytes() const {
+        uints n = _allocated.resident_virtual() + _summary.resident_virtual();
+        if coid_constexpr_if (LINEAR)
+            n += this->_array.resident_virtual();
+        else
+            n += this->_pages.resident_virtual();
+        extarray_iterate([&n](const auto& a) { n += a.resident_virtual(); });
+        return n;
+    }
+
     //@{ accessors with versionid argument, enabled only if versioning is on
 
     ///Return an item given id
@@ -705,6 +775,8 @@ public:
     //@note a deleted item in POOL mode is also considered newly created here
     T* get_or_create(uints id, bool* is_new = 0)
     {
+        static_assert(!CONCURRENT, "not available in concurrent mode");
+
         if (id == UMAXS) {
             if (is_new) *is_new = true;
             return add();
@@ -754,6 +826,8 @@ public:
     //@param is_new optional if not null, receives true if the item was newly created (also not restored from pool)
     T* get_or_create_uninit(uints id, bool* is_new = 0)
     {
+        static_assert(!CONCURRENT, "not available in concurrent mode");
+
         if (id == UMAXS) {
             if (is_new) *is_new = true;
             return add_uninit();
@@ -891,8 +965,13 @@ public:
             extarray_reset_count();
 
         _count = 0;
+        _free_bound = 0;
 
         _allocated.set_size(0);
+        _summary.set_size(0);
+
+        if coid_constexpr_if(CONCURRENT)
+            set_capacity(this->_capacity);
     }
 
     ///Discard content. Also destroys pooled objects and frees memory
@@ -904,7 +983,9 @@ public:
         extarray_discard();
 
         _count = 0;
+        _free_bound = 0;
         _allocated.discard();
+        _summary.discard();
 
         if coid_constexpr_if (LINEAR) {
             this->_array.discard();
@@ -913,6 +994,47 @@ public:
             this->_pages.discard();
             this->_created = 0;
         }
+
+        if coid_constexpr_if(CONCURRENT)
+            this->_capacity = 0;
+    }
+
+    ///Move live items into a dense prefix, releasing the trailing memory when done
+    //@param max_moves maximum number of items to move in this call, to run the compaction in bounded time slices
+    //@param fn callback invoked as fn(uints old_id, uints new_id) for each moved item, to let dependents patch their references
+    //@return true if the container is compact (and trailing pages were released), false if another call is needed
+    //@note items are moved from the highest used slots into the lowest free ones, by move construction (move
+    // assignment in pool mode), along with their ext array values; the version of the old slot is bumped.
+    // Tracking containers keep the trailing slots, so that the delta consumers receive the tombstones
+    template <typename Func>
+    bool compact(uints max_moves, Func fn)
+    {
+        static_assert(!CONCURRENT, "not available in concurrent mode");
+
+        //the dense prefix is skipped using the free slot bound kept from previous calls, and the emptied
+        // tail using the summary bitmap, so that a slice costs O(max_moves) rather than O(capacity)
+        uints src = prev_allocated(created());
+        uints dst = next_free(_free_bound);
+
+        for (uints n = 0; src != UMAXS && dst < src; ++n) {
+            if (n >= max_moves) {
+                _free_bound = dst;
+                return false;
+            }
+
+            move_item(src, dst);
+            fn(src, dst);
+
+            src = prev_allocated(src);
+            dst = next_free(dst + 1);
+        }
+
+        _free_bound = stdmin(dst, created());
+
+        if coid_constexpr_if(!TRACKING)
+            trim(src == UMAXS ? 0 : src + 1);
+
+        return true;
     }
 
 #ifdef COID_CONSTEXPR_IF
@@ -1219,66 +1341,20 @@ public:
     template<typename Func>
     void for_each(Func f) const
     {
-        if coid_constexpr_if (LINEAR) {
-            typedef std::remove_reference_t<typename closure_traits<Func>::template arg<0>> Tx;
-            Tx* d = const_cast<Tx*>(this->_array.ptr());
-            uint_type const* b = const_cast<uint_type const*>(_allocated.ptr());
-            uint_type const* e = const_cast<uint_type const*>(_allocated.ptre());
-            uints s = 0;
-
-            for (uint_type const* p = b; p != e; ++p, s += MASK_BITS) {
-                if (*p == 0)
-                    continue;
-
-                uints m = 1;
-                for (int i = 0; i < MASK_BITS; ++i, m <<= 1) {
-                    if (*p & m)
-                        funccall(f, d[s + i], s + i);
-                    else if ((*p & ~(m - 1)) == 0)
-                        break;
-                }
-            }
-        }
-        else {
-            uint_type const* bm = const_cast<uint_type const*>(_allocated.ptr());
-            uint_type const* em = const_cast<uint_type const*>(_allocated.ptre());
-            uint_type const* pm = bm;
-            uints gbase = 0;
-
-            for (uints ip = 0; ip < this->_pages.size(); ++ip, gbase += storage_t::PAGE_ITEMS)
-            {
-                const typename storage_t::page& pp = this->_pages[ip];
-                T* data = const_cast<T*>(pp.ptr());
-
-                uint_type const* epm = em - pm > storage_t::NMASK
-                    ? pm + storage_t::NMASK
-                    : em;
-
-                uints pbase = 0;
-
-                for (; pm != epm; ++pm, pbase += MASK_BITS) {
-                    if (*pm == 0)
-                        continue;
-
-                    uints m = 1;
-                    for (int i = 0; i < MASK_BITS; ++i, m <<= 1) {
-                        if (*pm & m)
-                            funccall(f, data[pbase + i], gbase + pbase + i);
-                        else if ((*pm & ~(m - 1)) == 0)
-                            break;
+        for_each_in_words(0, _allocated.size(), f);
+    }
 
-                        //update after rebase
-                        ints diffm = (ints)const_cast<uint_type const*>(_allocated.ptr()) - (ints)bm;
-                        if (diffm) {
-                            bm = ptr_byteshift(bm, diffm);
-                            em = const_cast<uint_type const*>(_allocated.ptre());
-                            pm = ptr_byteshift(pm, diffm);
-                            epm = ptr_byteshift(epm, diffm);
-                        }
-                    }
-                }
-            }
-        }
+    ///Invoke a functor on each used item in parallel, on taskmaster worker threads
+    //@param tm taskmaster to run on
+    //@param f functor with ([const] T&) or ([const] T&, size_t index) arguments, invoked concurrently
+    //@note the slot range is split on bitmap word boundaries, so each item and its changeset entry is touched
+    // by a single task; items must not be added or deleted during the iteration (except in the concurrent mode)
+    template<typename TM, typename Func>
+    void parallel_for_each(TM& tm, Func f) const
+    {
+        tm.parallel_for(uints(0), uints(_allocated.size()), typename TM::auto_partitioner(), [this, &f](uints wb, uints we) {
+            for_each_in_words(wb, we, f);
+        });
     }
 
     ///Invoke a functor on each used item in given ext array
@@ -1288,36 +1364,10 @@ public:
     template<int K, typename Func>
     void for_each_in_array(Func f) const
     {
-        auto extarray = value_array<K>().ptr();
-
-        uint_type const* bm = const_cast<uint_type const*>(_allocated.ptr());
-        uint_type const* em = const_cast<uint_type const*>(_allocated.ptre());
-        uints s = 0;
-
-        for (uint_type const* pm = bm; pm != em; ++pm, s += MASK_BITS) {
-            if (*pm == 0)
-                continue;
-
-            uints m = 1;
-            for (int i = 0; i < MASK_BITS; ++i, m <<= 1) {
-                if (*pm & m)
-                    funccall(f, extarray[s + i], s + i);
-                else if ((*pm & ~(m - 1)) == 0)
-                    break;
+        const uints nwords = _allocated.size();
 
-                //update after rebase
-                ints diffm = (ints)const_cast<uint_type const*>(_allocated.ptr()) - (ints)bm;
-                if (diffm) {
-                    bm = ptr_byteshift(bm, diffm);
-                    em = const_cast<uint_type const*>(_allocated.ptre());
-                    pm = ptr_byteshift(pm, diffm);
-                }
-
-                ints diffa = (ints)value_array<K>().ptr() - (ints)extarray;
-                if (diffa)
-                    extarray = ptr_byteshift(extarray, diffa);
-            }
-        }
+        for (uints id = next_allocated(0, nwords); id != UMAXS; id = next_allocated(id + 1, nwords))
+            funccall(f, value_array<K>().ptr()[id], id);
     }
 
     ///Invoke a functor on each item that was modified between two frames
@@ -1327,62 +1377,120 @@ public:
     template<typename Func, bool T1 = TRACKING, typename = std::enable_if_t<T1>>
     void for_each_modified(uint bitplane_mask, Func f) const
     {
-        const bool all_modified = bitplane_mask > slotalloc_detail::changeset::BITPLANE_MASK;
+        for_each_modified_in_range(bitplane_mask, 0, tracker_t::get_changeset()->size(), f);
+    }
 
-        typedef std::remove_pointer_t<std::remove_reference_t<typename closure_traits<Func>::template arg<0>>> Tx;
-        uint_type const* bm = const_cast<uint_type const*>(_allocated.ptr());
-        uint_type const* em = const_cast<uint_type const*>(_allocated.ptre());
+    ///Invoke a functor on each item that was modified between two frames, in parallel on taskmaster worker threads
+    //@param tm taskmaster to run on
+    //@param bitplane_mask changeset bitplane mask (slotalloc_detail::changeset::bitplane_mask)
+    //@param f functor with ([const] T* ptr) or ([const] T* ptr, size_t index) arguments, invoked concurrently; ptr can be null if item was deleted
+    //@note the changeset is split on bitmap word boundaries, see parallel_for_each
+    template<typename TM, typename Func, bool T1 = TRACKING, typename = std::enable_if_t<T1>>
+    void parallel_for_each_modified(TM& tm, uint bitplane_mask, Func f) const
+    {
+        const uints n = tracker_t::get_changeset()->size();
 
-        auto chs = tracker_t::get_changeset();
-        DASSERT(chs->size() >= uints(em - bm));
+        tm.parallel_for(uints(0), align_to_chunks(n, MASK_BITS), typename TM::auto_partitioner(), [this, bitplane_mask, n, &f](uints wb, uints we) {
+            for_each_modified_in_range(bitplane_mask, wb * MASK_BITS, stdmin(n, we * MASK_BITS), f);
+        });
+    }
 
-        const changeset_t* bc = chs->ptr();
-        const changeset_t* ec = chs->ptre();
-        if coid_constexpr_if (LINEAR) {
-            T* pd0 = const_cast<T*>(this->_array.ptr());
-            uint_type const* pm = bm;
+    ///Write a delta of items modified between two frames into a binstream
+    //@param bitplane_mask changeset bitplane mask (slotalloc_detail::changeset::bitplane_mask)
+    //@return number of slots written
+    //@note modified slots are coalesced into runs of live items (written with their ext array values and version)
+    // and runs of tombstones (deleted items, without payload), applied by read_delta on the receiving side
+    template<bool T1 = TRACKING, typename = std::enable_if_t<T1>>
+    uints write_delta(binstream& bin, uint bitplane_mask) const
+    {
+        bin << uint8(VERSIONING ? 1 : 0) << uint8(sizeof...(Es));
+
+        uints nslots = 0;
+        uints next = 0;                 //< slot following the last written run
+        uints start = 0, n = 0;
+        bool live = false;
+
+        auto flush = [&]() {
+            bin << uint32(start - next) << uint32(n) << uint8(live);
+            if (live) {
+                for (uints id = start; id < start + n; ++id)
+                    write_slot(bin, id);
+            }
+            next = start + n;
+            nslots += n;
+        };
+
+        for_each_modified(bitplane_mask, [&](const T* p, uints id) {
+            if (n && (id != start + n || live != (p != 0))) {
+                flush();
+                n = 0;
+            }
+            if (!n) {
+                start = id;
+                live = p != 0;
+            }
+            ++n;
+        });
 
-            for (const changeset_t* ch = bc; ch < ec; ++pm) {
-                uints m = pm < em ? *pm : 0U;
-                uints idbase = (pm - bm) * MASK_BITS;
+        if (n)
+            flush();
 
-                for (int i = 0; ch < ec && i < MASK_BITS; ++i, m >>= 1, ++ch) {
-                    if (all_modified || (ch->mask & bitplane_mask) != 0) {
-                        T* pd = (m & 1) != 0 ? pd0 + (idbase + i) : 0;
-                        funccallp(f, pd, idbase + i);
-                    }
-                }
-            }
-        }
-        else {
-            const storage_t::page* bp = this->_pages.ptr();
-            const storage_t::page* ep = this->_pages.ptre();
+        bin << uint32(0) << uint32(0);
+        return nslots;
+    }
 
-            uint_type const* pm = bm;
-            changeset_t const* pc = bc;
-            uints gbase = 0;
+    ///Write a delta of items modified since given frame into a binstream
+    //@param since_frame frame number (as returned by advance_frame) of the oldest modifications to include
+    //@return number of slots written
+    //@note frames too old to be tracked by the changeset produce a full snapshot, with all unused slots as tombstones
+    template<bool T1 = TRACKING, typename = std::enable_if_t<T1>>
+    uints write_delta_since(binstream& bin, uint since_frame) const
+    {
+        //bit plane 0 holds the current frame
+        int rel = int(since_frame) - int(*tracker_t::get_frame()) - 1;
+        uint mask = rel < 0
+            ? slotalloc_detail::changeset::bitplane_mask(slotalloc_detail::changeset::bitplane(rel))
+            : 0;
 
-            for (const storage_t::page* pp = bp; pp < ep; ++pp, gbase += storage_t::PAGE_ITEMS)
-            {
-                T* data = const_cast<T*>(pp->data);
-                changeset_t const* epc = ec - pc > storage_t::NMASK
-                    ? pc + storage_t::PAGE_ITEMS
-                    : ec;
+        return write_delta(bin, mask);
+    }
 
-                uints pbase = 0;
+    ///Apply a delta written by write_delta
+    //@return number of slots updated
+    //@note the receiving container has to be of the same type and in the state the delta was made against;
+    // live items are created or overwritten in their original slots, tombstoned items are deleted
+    uints read_delta(binstream& bin)
+    {
+        uint8 versioning, nexts;
+        bin >> versioning >> nexts;
 
-                for (; pc < epc; ++pm, pbase += MASK_BITS) {
-                    uints m = pm < em ? *pm : 0U;
+        if (versioning != (VERSIONING ? 1 : 0) || nexts != sizeof...(Es))
+            throw exception("slotalloc delta layout mismatch");
 
-                    for (int i = 0; pc < epc && i < MASK_BITS; ++i, m >>= 1, ++pc) {
-                        if (all_modified || (pc->mask & bitplane_mask) != 0) {
-                            T* pd = (m & 1) != 0 ? (T*)(data + pbase + i) : nullptr;
-                            funccallp(f, pd, gbase + pbase + i);
-                        }
-                    }
-                }
+        uints nslots = 0;
+        uints id = 0;
+
+        for (;;) {
+            uint32 skip, n;
+            bin >> skip >> n;
+            if (!n)
+                break;
+
+            uint8 live;
+            bin >> live;
+
+            id += skip;
+            nslots += n;
+
+            for (uints e = id + n; id < e; ++id) {
+                if (live)
+                    read_slot(bin, id);
+                else if (id < created() && get_bit(id))
+                    del_item(id);
             }
         }
+
+        return nslots;
     }
 
     ///Run f(T*) on a range of items
@@ -1425,75 +1533,18 @@ public:
     template<typename Func>
     T* find_if(Func f) const
     {
-        uint_type const* bm = const_cast<uint_type const*>(_allocated.ptr());
-        uint_type const* em = const_cast<uint_type const*>(_allocated.ptre());
+        const uints nwords = _allocated.size();
 
-        if coid_constexpr_if (LINEAR) {
-            uints base = 0;
-            T* pd0 = const_cast<T*>(this->_array.ptr());
+        for (uints id = next_allocated(0, nwords); id != UMAXS; id = next_allocated(id + 1, nwords)) {
+            T* p = const_cast<T*>(ptr(id));
 
-            for (uint_type const* pm = bm; pm != em; ++pm, base += MASK_BITS) {
-                if (*pm == 0)
-                    continue;
-
-                uints m = 1;
-                for (int i = 0; i < MASK_BITS; ++i, m <<= 1) {
-                    if (*pm & m) {
-                        uints id = base + i;
-                        if (funccall(f, pd0[id], base + i))
-                            return pd0 + id;
-
-                        //update after rebase
-                        ints diffm = (ints)const_cast<uint_type const*>(_allocated.ptr()) - (ints)bm;
-                        if (diffm) {
-                            bm = ptr_byteshift(bm, diffm);
-                            em = const_cast<uint_type const*>(_allocated.ptre());
-                            pm = ptr_byteshift(pm, diffm);
-                        }
-                    }
-                    else if ((*pm & ~(m - 1)) == 0)
-                        break;
-                }
+            if coid_constexpr_if (LINEAR) {
+                if (funccall(f, *p, id))
+                    return p;
             }
-        }
-        else {
-            uint_type const* pm = bm;
-            uints gbase = 0;
-
-            for (uints ip = 0; ip < this->_pages.size(); ++ip, gbase += storage_t::PAGE_ITEMS)
-            {
-                const typename storage_t::page& pp = this->_pages[ip];
-                T* data = const_cast<T*>(pp.ptr());
-
-                uint_type const* epm = em - pm > storage_t::NMASK
-                    ? pm + storage_t::NMASK
-                    : em;
-
-                uints pbase = 0;
-
-                for (; pm != epm; ++pm, pbase += MASK_BITS) {
-                    if (*pm == 0)
-                        continue;
-
-                    uints m = 1;
-                    for (int i = 0; i < MASK_BITS; ++i, m <<= 1) {
-                        if (*pm & m) {
-                            if (funccall_if(f, data[pbase + i], gbase + pbase + i))
-                                return const_cast<T*>(data) + (pbase + i);
-
-                            //update after rebase
-                            ints diffm = (ints)const_cast<uint_type const*>(_allocated.ptr()) - (ints)bm;
-                            if (diffm) {
-                                bm = ptr_byteshift(bm, diffm);
-                                em = const_cast<uint_type const*>(_allocated.ptre());
-                                pm = ptr_byteshift(pm, diffm);
-                                epm = ptr_byteshift(epm, diffm);
-                            }
-                        }
-                        else if ((*pm & ~(m - 1)) == 0)
-                            break;
-                    }
-                }
+            else {
+                if (funccall_if(f, *p, id))
+                    return p;
             }
         }
 
@@ -1538,13 +1589,13 @@ public:
             }
         }
         else {
-            const storage_t::page* pb = this->_pages.ptr();
-            const storage_t::page* pe = this->_pages.ptre();
+            const typename storage_t::page* pb = this->_pages.ptr();
+            const typename storage_t::page* pe = this->_pages.ptre();
 
             uint_type const* pm = bm;
             uints gbase = 0;
 
-            for (const storage_t::page* pp = pb; pp < pe; ++pp, gbase += storage_t::PAGE_ITEMS)
+            for (const typename storage_t::page* pp = pb; pp < pe; ++pp, gbase += storage_t::PAGE_ITEMS)
             {
                 T* d = const_cast<T*>(pp->ptr());
                 uint_type const* epm = em - pm > storage_t::NMASK
@@ -1591,7 +1642,7 @@ public:
         uints b = k % NBITS;
 
         U m = U(1) << b;
-        B& v = bitarray.get_or_addc(s);
+        B& v = bitmap_word(bitarray, s);
         return (Ub::fetch_or(v, m) & m) != 0;
     }
 
@@ -1605,10 +1656,29 @@ public:
         uints b = k % NBITS;
 
         U m = U(1) << b;
-        B& v = bitarray.get_or_addc(s);
+        B& v = bitmap_word(bitarray, s);
         return (Ub::fetch_and(v, ~m) & m) != 0;
     }
 
+    ///Append n zeroed words to a bitmap
+    //@note words are value-initialized instead of memset, bitmaps of concurrent containers hold atomics
+    template <class B>
+    static void bitmap_grow(dynarray<B>& bitarray, uints n)
+    {
+        B* p = bitarray.add_uninit(n);
+        for (uints i = 0; i < n; ++i)
+            new(p + i) B(0);
+    }
+
+    //@return bitmap word at given index, growing the bitmap if needed
+    template <class B>
+    static B& bitmap_word(dynarray<B>& bitarray, uints s)
+    {
+        if (s >= bitarray.size())
+            bitmap_grow(bitarray, s + 1 - bitarray.size());
+        return bitarray[s];
+    }
+
     template <class B>
     static bool get_bit(const dynarray<B>& bitarray, uints k)
     {
@@ -1676,32 +1746,47 @@ protected:
 private:
 
     dynarray<uint_type> _allocated;     //< bit mask for allocated/free items
+    dynarray<uint_type> _summary;       //< bit per SUMMARY_ITEMS slots, cleared if none of them is allocated
 
     uint_type _count = 0;               //< active element count
+    uints _free_bound = 0;              //< no free slot below this id, lowered on deletion (not maintained in concurrent mode)
 
 #ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunused-variable"
 #endif
 
-    ///Helper to expand all ext arrays
+    ///Helper to expand all ext arrays to given size
+    //@note the version array may be longer than the created slots after trim
     template<size_t... Index>
-    void extarray_expand_(index_sequence<Index...>, uints n) {
-        int dummy[] = {0, ((void)std::get<Index>(this->_exts).add(n), 0)...};
+    void extarray_expand_(index_sequence<Index...>, uints size) {
+        int dummy[] = {0, ((void)extarray_add(std::get<Index>(this->_exts), size), 0)...};
+    }
+
+    template<class A>
+    static void extarray_add(A& a, uints size) {
+        if (size > a.size())
+            a.add(size - a.size());
     }
 
     void extarray_expand(uints n) {
-        extarray_expand_(make_index_sequence<tracker_t::extarray_size>(), n);
+        extarray_expand_(make_index_sequence<tracker_t::extarray_size>(), created() + n);
     }
 
-    ///Helper to expand all ext arrays
+    ///Helper to expand all ext arrays to given size
     template<size_t... Index>
-    void extarray_expand_uninit_(index_sequence<Index...>, uints n) {
-        int dummy[] = {0, ((void)std::get<Index>(this->_exts).add_uninit(n), 0)...};
+    void extarray_expand_uninit_(index_sequence<Index...>, uints size) {
+        int dummy[] = {0, ((void)extarray_add_uninit(std::get<Index>(this->_exts), size), 0)...};
+    }
+
+    template<class A>
+    static void extarray_add_uninit(A& a, uints size) {
+        if (size > a.size())
+            a.add_uninit(size - a.size());
     }
 
     void extarray_expand_uninit(uints n = 1) {
-        extarray_expand_uninit_(make_index_sequence<tracker_t::extarray_size>(), n);
+        extarray_expand_uninit_(make_index_sequence<tracker_t::extarray_size>(), created() + n);
     }
 
     ///Helper to reset all ext arrays
@@ -1753,6 +1838,47 @@ private:
     }
 
 
+    ///Helper to write ext array values of given slot (without internal arrays)
+    template<size_t... Index>
+    void extarray_write_(index_sequence<Index...>, binstream& bin, uints id) const {
+        int dummy[] = {0, ((void)(bin << std::get<Index>(this->_exts)[id]), 0)...};
+    }
+
+    ///Helper to read ext array values of given slot (without internal arrays)
+    template<size_t... Index>
+    void extarray_read_(index_sequence<Index...>, binstream& bin, uints id) {
+        int dummy[] = {0, ((void)(bin >> std::get<Index>(this->_exts)[id]), 0)...};
+    }
+
+    ///Write item, ext array values and version of given slot
+    void write_slot(binstream& bin, uints id) const
+    {
+        bin << *ptr(id);
+        extarray_write_(make_index_sequence<sizeof...(Es)>(), bin, id);
+
+        if coid_constexpr_if(VERSIONING)
+            bin << uint8(tracker_t::version_array()[id]);
+    }
+
+    ///Read item, ext array values and version into given slot, creating the item if needed
+    void read_slot(binstream& bin, uints id)
+    {
+        bin >> *get_or_create(id);
+        extarray_read_(make_index_sequence<sizeof...(Es)>(), bin, id);
+
+        if coid_constexpr_if(VERSIONING) {
+            uint8 version;
+            bin >> version;
+            tracker_t::version_array()[id] = version;
+        }
+    }
+
+    ///Helper to move ext array values between slots (without internal arrays)
+    template<size_t... Index>
+    void extarray_move_(index_sequence<Index...>, uints src, uints dst) {
+        int dummy[] = {0, ((void)(std::get<Index>(this->_exts)[dst] = std::move(std::get<Index>(this->_exts)[src])), 0)...};
+    }
+
     ///Helper to iterate over all ext arrays
     template<typename F, size_t... Index>
     void extarray_iterate_(index_sequence<Index...>, F fn) {
@@ -1764,6 +1890,16 @@ private:
         extarray_iterate_(make_index_sequence<tracker_t::extarray_size>(), fn);
     }
 
+    template<typename F, size_t... Index>
+    void extarray_iterate_(index_sequence<Index...>, F fn) const {
+        int dummy[] = {0, ((void)fn(std::get<Index>(this->_exts)), 0)...};
+    }
+
+    template<typename F>
+    void extarray_iterate(F fn) const {
+        extarray_iterate_(make_index_sequence<tracker_t::extarray_size>(), fn);
+    }
+
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
@@ -1791,6 +1927,17 @@ private:
     {
         DASSERT(_count < created());
 
+        if coid_constexpr_if(CONCURRENT) {
+            uints id = claim_slot();
+            if (pid)
+                *pid = id;
+
+            set_summary(id);
+            ++_count;
+
+            return ptr(id);
+        }
+
         uint_type* p = _allocated.ptr();
         uint_type* e = _allocated.ptre();
         for (; p != e && *p == UMAXS; ++p);
@@ -1810,6 +1957,7 @@ private:
             *pid = id;
 
         *p |= uints(1) << bit;
+        set_summary(id);
         ++_count;
 
         return ptr(id);
@@ -1825,6 +1973,7 @@ private:
         uint8 bit = id & (MASK_BITS - 1);
 
         *p |= uints(1) << bit;
+        set_summary(id);
         ++_count;
 
         this->set_modified(id);
@@ -1837,13 +1986,16 @@ private:
     template <bool UNINIT>
     uints alloc_range(uints n, uints* old)
     {
+        static_assert(!CONCURRENT, "not available in concurrent mode");
+
         uints id = find_zero_bitrange(n, _allocated.ptr(), _allocated.ptre());
         uints nslots = align_to_chunks(id + n, MASK_BITS);
 
         if (nslots > _allocated.size())
-            _allocated.addc(nslots - _allocated.size());
+            bitmap_grow(_allocated, nslots - _allocated.size());
 
         set_bitrange(id, n, _allocated.ptr());
+        set_summary_range(id, n);
 
         uints ncr = created();
         uints nadd = id + n > ncr ? id + n - ncr : 0;
@@ -1862,6 +2014,8 @@ private:
     template <bool UNINIT>
     uints alloc_range_contiguous(uints n, uints* old)
     {
+        static_assert(!CONCURRENT, "not available in concurrent mode");
+
         if coid_constexpr_if (!LINEAR) {
             if (n > storage_t::PAGE_ITEMS)
                 return UMAXS;
@@ -1909,9 +2063,10 @@ private:
         uints nslots = align_to_chunks(id + n, MASK_BITS);
 
         if (nslots > _allocated.size())
-            _allocated.addc(nslots - _allocated.size());
+            bitmap_grow(_allocated, nslots - _allocated.size());
 
         set_bitrange(id, n, _allocated.ptr());
+        set_summary_range(id, n);
 
         uints ncr = created();
         uints nadd = id + n > ncr ? id + n - ncr : 0;
@@ -1929,6 +2084,9 @@ private:
     template <bool EXT_UNINIT>
     T* append(uints* pid = 0)
     {
+        if coid_constexpr_if(CONCURRENT)
+            throw exception("concurrent slotalloc capacity exceeded");
+
         uints count = created();
 
         DASSERT(_count <= count);   //count may be lower with other threads deleting, but not higher (single producer)
@@ -2000,10 +2158,370 @@ private:
 #endif
     }
 
-    bool set_bit(uints k) { return set_bit(_allocated, k); }
-    bool clear_bit(uints k) { return clear_bit(_allocated, k); }
+    bool set_bit(uints k) {
+        bool was = set_bit(_allocated, k);
+        set_summary(k);
+        return was;
+    }
+
+    bool clear_bit(uints k) {
+        bool was = clear_bit(_allocated, k);
+        if (was && uints(_allocated[k / MASK_BITS]) == 0)
+            update_summary(k / SUMMARY_ITEMS);
+
+        if coid_constexpr_if(!CONCURRENT)
+            if (k < _free_bound)
+                _free_bound = k;
+
+        //next allocation from this thread will try the freed slot first
+        if coid_constexpr_if(CONCURRENT)
+            this->thread_hint().freed.store(k / MASK_BITS, std::memory_order_relaxed);
+        return was;
+    }
+
+    ///Claim a free slot in the concurrent mode
+    //@note tries the word with a slot freed by the calling thread first, then continues from the thread's
+    // allocation frontier; slots are taken with an atomic fetch_or
+    //@return id of the claimed slot
+    uints claim_slot()
+    {
+        auto& hint = this->thread_hint();
+        const uints nwords = _allocated.size();
+
+        uints w = hint.freed.exchange(UMAXS, std::memory_order_relaxed);
+        if (w < nwords) {
+            uints id = claim_slot_in_word(w);
+            if (id != UMAXS)
+                return id;
+        }
+
+        w = hint.frontier.load(std::memory_order_relaxed);
+
+        for (uints i = 0; i < nwords; ++i, ++w) {
+            if (w >= nwords)
+                w = 0;
+
+            uints id = claim_slot_in_word(w);
+            if (id != UMAXS) {
+                hint.frontier.store(w, std::memory_order_relaxed);
+                return id;
+            }
+        }
+
+        throw exception("concurrent slotalloc capacity exceeded");
+    }
+
+    //@return id of a slot claimed in given bitmap word, or UMAXS if the word is full
+    uints claim_slot_in_word(uints w)
+    {
+        using Ub = underlying_bitrange_type<uint_type>;
+
+        uint_type& word = _allocated[w];
+        uints v = uints(word);
+
+        while (v != UMAXS) {
+            uint8 bit = lsb_bit_set(~v);
+            uints m = uints(1) << bit;
+
+            v = Ub::fetch_or(word, m);
+            if (!(v & m))
+                return w * MASK_BITS + bit;
+        }
+
+        return UMAXS;
+    }
+
+    ///Size the main array, the bitmaps and ext arrays to given capacity, so that nothing has to be resized during the concurrent use
+    void set_capacity(uints n)
+    {
+        uints ncr = created();
+        if (n > ncr) {
+            extarray_expand(n - ncr);
+            expand<true>(n - ncr);
+        }
+
+        uints na = align_to_chunks(n, MASK_BITS);
+        if (na > _allocated.size())
+            bitmap_grow(_allocated, na - _allocated.size());
+
+        uints ns = align_to_chunks(n, SUMMARY_ITEMS * MASK_BITS);
+        if (ns > _summary.size())
+            bitmap_grow(_summary, ns - _summary.size());
+
+        this->_capacity = n;
+        this->spread_hints(na);
+    }
+
     bool get_bit(uints k) const { return get_bit(_allocated, k); }
 
+    ///Find next allocated slot
+    //@param id slot to start the search at
+    //@param nwords number of bitmap words to search
+    //@return id of the next allocated slot or UMAXS if there's none
+    //@note the bitmap is re-read on each call, so items deleted or reused during iteration are handled
+    uints next_allocated(uints id, uints nwords) const
+    {
+        uints w = id / MASK_BITS;
+        if (w >= nwords)
+            return UMAXS;
+
+        uints m = uints(_allocated[w]) & (UMAXS << (id % MASK_BITS));
+
+        while (!m) {
+            w = next_allocated_word(w + 1, nwords);
+            if (w >= nwords)
+                return UMAXS;
+
+            m = uints(_allocated[w]);
+        }
+
+        return w * MASK_BITS + lsb_bit_set(m);
+    }
+
+    ///Invoke a functor on each used item within given range of bitmap words
+    template<typename Func>
+    void for_each_in_words(uints wb, uints we, Func& f) const
+    {
+        for (uints id = next_allocated(wb * MASK_BITS, we); id != UMAXS; id = next_allocated(id + 1, we))
+            funccall(f, *const_cast<T*>(ptr(id)), id);
+    }
+
+    ///Invoke a functor on each item modified between two frames within given range of slots
+    template<typename Func>
+    void for_each_modified_in_range(uint bitplane_mask, uints from, uints to, Func& f) const
+    {
+        const bool all_modified = bitplane_mask > slotalloc_detail::changeset::BITPLANE_MASK;
+
+        auto chs = tracker_t::get_changeset();
+        DASSERT(chs->size() >= _allocated.size());
+
+        //changeset entries are scanned as plain masks, skipping unmodified runs 256 bits at a time
+        static_assert(sizeof(changeset_t) == sizeof(uint16), "unexpected changeset layout");
+        const uint16* bc = reinterpret_cast<const uint16*>(chs->ptr());
+        const uint16* ec = bc + to;
+        const uint16 mask = uint16(bitplane_mask);
+
+        for (const uint16* pc = bc + from; pc < ec; ++pc) {
+            if (!all_modified) {
+                pc = find_masked_uint16(pc, ec, mask);
+                if (pc == ec)
+                    break;
+            }
+
+            uints id = pc - bc;
+            T* pd = get_bit(id) ? const_cast<T*>(ptr(id)) : nullptr;
+            funccallp(f, pd, id);
+        }
+    }
+
+    ///Find previous allocated slot
+    //@return id of the last allocated slot below given id, or UMAXS if there's none
+    uints prev_allocated(uints id) const
+    {
+        uints w = id / MASK_BITS;
+
+        if (w < _allocated.size()) {
+            uints m = uints(_allocated[w]) & ((uints(1) << (id % MASK_BITS)) - 1);
+            if (m)
+                return w * MASK_BITS + msb_bit_set(m);
+        }
+        else
+            w = _allocated.size();
+
+        //walk back over the blocks with a set summary bit only
+        while (w > 0) {
+            uints block = prev_summary_block((w - 1) / SUMMARY_WORDS);
+            if (block == UMAXS)
+                return UMAXS;
+
+            uints b = block * SUMMARY_WORDS;
+            w = stdmin(w, b + SUMMARY_WORDS);
+
+            while (w > b) {
+                uints m = uints(_allocated[--w]);
+                if (m)
+                    return w * MASK_BITS + msb_bit_set(m);
+            }
+        }
+
+        return UMAXS;
+    }
+
+    ///Find previous block with allocated items
+    //@return block index at or below given one with a set summary bit, or UMAXS if there's none
+    uints prev_summary_block(uints block) const
+    {
+        uints sw = block / MASK_BITS;
+        uints m = 0;
+
+        if (sw < _summary.size())
+            m = uints(_summary[sw]) & (UMAXS >> (MASK_BITS - 1 - block % MASK_BITS));
+        else
+            sw = _summary.size();
+
+        while (!m) {
+            if (sw == 0)
+                return UMAXS;
+            m = uints(_summary[--sw]);
+        }
+
+        return sw * MASK_BITS + msb_bit_set(m);
+    }
+
+    ///Find next free slot
+    //@return id of the first unallocated slot at or above given id
+    uints next_free(uints id) const
+    {
+        const uints nwords = _allocated.size();
+        uints w = id / MASK_BITS;
+        if (w >= nwords)
+            return id;
+
+        uints m = ~uints(_allocated[w]) & (UMAXS << (id % MASK_BITS));
+
+        while (!m) {
+            if (++w >= nwords)
+                return nwords * MASK_BITS;
+            m = ~uints(_allocated[w]);
+        }
+
+        return w * MASK_BITS + lsb_bit_set(m);
+    }
+
+    ///Move item with its ext array values into a free slot
+    void move_item(uints src, uints dst)
+    {
+        T* ps = ptr(src);
+        T* pd = ptr(dst);
+
+        if coid_constexpr_if(POOL) {
+            //all created slots hold constructed objects in pool mode
+            *pd = std::move(*ps);
+        }
+        else {
+            new(pd) T(std::move(*ps));
+            ps->~T();
+        }
+
+        extarray_move_(make_index_sequence<sizeof...(Es)>(), src, dst);
+
+        set_bit(dst);
+        clear_bit(src);
+
+        this->bump_version(src);
+        this->set_modified(src);
+        this->set_modified(dst);
+    }
+
+    ///Release storage of unused trailing slots
+    //@param n number of slots to keep
+    void trim(uints n)
+    {
+        uints ncr = created();
+        if (n >= ncr)
+            return;
+
+        if coid_constexpr_if(POOL)
+            for_range_unchecked(n, ncr - n, [](T* p) { destroy(*p); });
+
+        if coid_constexpr_if(LINEAR) {
+            this->_array.set_size(n);
+            this->_array.release_virtual();
+        }
+        else {
+            this->_created = n;
+            this->_pages.realloc(align_to_chunks(n, storage_t::PAGE_ITEMS));
+        }
+
+        //virtual reservations don't shrink on realloc, return their trailing pages explicitly
+        //@note the version array isn't trimmed, so that old versionids of the trimmed slots stay invalid once the slots are reused
+        extarray_iterate_(make_index_sequence<sizeof...(Es)>(), [n](auto& a) { a.realloc(n); a.release_virtual(); });
+
+        _allocated.set_size(align_to_chunks(n, MASK_BITS));
+        _allocated.release_virtual();
+        _summary.set_size(align_to_chunks(n, SUMMARY_ITEMS * MASK_BITS));
+        _summary.release_virtual();
+    }
+
+    ///Find next non-empty bitmap word, skipping blocks with a cleared summary bit
+    //@return word index or nwords if there's none
+    uints next_allocated_word(uints w, uints nwords) const
+    {
+        uint_type const* bm = _allocated.ptr();
+        const uints nsummary = _summary.size();
+
+        while (w < nwords) {
+            uints block = w / SUMMARY_WORDS;
+            uints sw = block / MASK_BITS;
+            if (sw >= nsummary)
+                break;
+
+            uints sm = uints(_summary[sw]) & (UMAXS << (block % MASK_BITS));
+            if (!sm) {
+                w = (sw + 1) * MASK_BITS * SUMMARY_WORDS;
+                continue;
+            }
+
+            uints nblock = sw * MASK_BITS + lsb_bit_set(sm);
+            if (nblock > block)
+                w = nblock * SUMMARY_WORDS;
+            if (w >= nwords)
+                break;
+
+            uint_type const* e = bm + stdmin(nwords, (nblock + 1) * SUMMARY_WORDS);
+            uint_type const* p = find_nonzero_word(bm + w, e);
+            if (p != e)
+                return p - bm;
+
+            w = e - bm;
+        }
+
+        return nwords;
+    }
+
+    //@{ summary bitmap functions
+    //@note the summary bit is set after the item bit, and cleared before rechecking the block,
+    // so that a concurrent allocation never leaves a cleared summary bit over a non-empty block
+
+    void set_summary(uints k) {
+        uints block = k / SUMMARY_ITEMS;
+        if (!get_bit(_summary, block))
+            set_bit(_summary, block);
+    }
+
+    void set_summary_range(uints k, uints n) {
+        for (uints b = k / SUMMARY_ITEMS, e = (k + n - 1) / SUMMARY_ITEMS; b <= e; ++b) {
+            if (!get_bit(_summary, b))
+                set_bit(_summary, b);
+        }
+    }
+
+    ///Clear the summary bit of given block if it doesn't contain allocated items anymore
+    void update_summary(uints block)
+    {
+        uint_type const* b = _allocated.ptr() + block * SUMMARY_WORDS;
+        uint_type const* e = _allocated.ptr() + stdmin(_allocated.size(), (block + 1) * SUMMARY_WORDS);
+
+        if (find_nonzero_word(b, e) != e)
+            return;
+
+        clear_bit(_summary, block);
+
+        if coid_constexpr_if(ATOMIC)
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        //an item could have been allocated in the meantime
+        if (find_nonzero_word(b, e) != e)
+            set_bit(_summary, block);
+    }
+
+    void update_summary_range(uints k, uints n) {
+        for (uints b = k / SUMMARY_ITEMS, e = (k + n - 1) / SUMMARY_ITEMS; b <= e; ++b)
+            update_summary(b);
+    }
+
+    //@}
+
     //WA for lambda template error
     void static destroy(T& p) { p.~T(); }
 
@@ -2118,4 +2636,11 @@ using slotalloc_tracking_atomic_linear = slotalloc_base<T, slotalloc_mode::atomi
 template<class T, class ...Es>
 using slotalloc_tracking_linear = slotalloc_base<T, slotalloc_mode::tracking | slotalloc_mode::linear, Es...>;
 
+///slotalloc with lock-free insertion/deletion from multiple threads, capacity has to be reserved upfront
+template<class T, class ...Es>
+using slotalloc_concurrent = slotalloc_base<T, slotalloc_mode::concurrent | slotalloc_mode::linear, Es...>;
+
+template<class T, class ...Es>
+using slotalloc_versioning_concurrent = slotalloc_base<T, slotalloc_mode::concurrent | slotalloc_mode::versioning | slotalloc_mode::linear, Es...>;
+
 COID_NAMESPACE_END
@@ -2,6 +2,8 @@
 #include "../str.h"
 #include "../rnd.h"
 
+#include <cstdio>
+
 //-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 
 struct test_data
@@ -58,6 +60,17 @@ void coid::test::slotalloc_bmp()
         ++i;
     }
 
+    DASSERT(data.count() == handles.size());
+
+    //bulk allocation fills the holes first, then whole words
+    uints nbulk = 0;
+    data.add_uninit(5000, [&](test_data* p) {
+        new (p) test_data("bulk", 1);
+        DASSERT(data.is_valid(data.get_item_id(p)));
+        ++nbulk;
+    });
+    DASSERT(nbulk == 5000 && data.count() == handles.size() + 5000);
+
     test_data * d = new (data.add_uninit()) test_data("Hello world!", 342);
     uints item = data.get_item_id(d);
 
@@ -8,15 +8,27 @@
 
 COID_NAMESPACE_BEGIN
 
-typedef uint BLOCK_TYPE;
+typedef uint64 BLOCK_TYPE;
 
+///Slot allocator with a hierarchical bitmap of used slots
+/// bitmap words hold 64 slots, each word has a bit in the level 1 summaries (one for words with a free
+/// slot, one for non-empty words), and each level 1 summary word has a bit in a level 2 summary,
+/// so that allocation and iteration need just a few tzcnt operations per step
 template<typename T>
 class slotalloc_bmp
 {
 private:
 
-    dynarray<BLOCK_TYPE> _bmp;
+    static constexpr uints WORD_BITS = 64;
+    static constexpr BLOCK_TYPE FULL = BLOCK_TYPE(-1);
+
+    dynarray<BLOCK_TYPE> _bmp;          //< used slots
+    dynarray<BLOCK_TYPE> _free1;        //< bit per _bmp word with a free slot
+    dynarray<BLOCK_TYPE> _free2;        //< bit per non-zero _free1 word
+    dynarray<BLOCK_TYPE> _used1;        //< bit per non-empty _bmp word
+    dynarray<BLOCK_TYPE> _used2;        //< bit per non-zero _used1 word
     dynarray<T> _items;
+    uints _count = 0;
 
 public:
 
@@ -25,9 +37,7 @@ public:
         : _bmp()
         , _items()
     {
-        _bmp.add_uninit(size >> 5);
-        memset(_bmp.ptr(), 0, _bmp.byte_size());
-        _items.add_uninit(_bmp.size() * sizeof(BLOCK_TYPE) * 8);
+        grow(align_to_chunks(size ? size : 1, WORD_BITS));
     }
 
     ~slotalloc_bmp()
@@ -46,33 +56,67 @@ public:
         }
 
         memset(_bmp.ptr(), 0, _bmp.byte_size());
+        memset(_used1.ptr(), 0, _used1.byte_size());
+        memset(_used2.ptr(), 0, _used2.byte_size());
+        fill_free_summary(0, _bmp.size());
+        _count = 0;
     }
 
-    /// TODO use SSE for faster iteration to free block?
-    /// SSE can do 16bytes at once our array is aligned
+    ///Allocate a slot
+    //@return pointer to uninitialized slot memory
     T* add_uninit()
     {
-        // find empty block 32bit
-        BLOCK_TYPE * b = _bmp.ptr();
-        BLOCK_TYPE * const be = _bmp.ptre();
-        while (b != be && *b == 0xffffffff)
-            b++;
-
-        if (b == be) {
-            const uints size = _bmp.size();
-            b = _bmp.add_uninit(size);
-            memset(b, 0, size * sizeof(BLOCK_TYPE));
-            _items.add_uninit(size * sizeof(BLOCK_TYPE) * 8);
-        }
-        else {
-            // in this case we now new block is empty we could skip search phase
+        uints w = next_word(_free1, _free2, 0);
+        if (w == UINTS_MAX) {
+            w = _bmp.size();
+            grow(w);
         }
 
-        uchar index = lsb_bit_set(~*b);
+        uint8 index = lsb_bit_set(~_bmp[w]);
+        take(w, BLOCK_TYPE(1) << index);
 
-        *b |= 1 << index;
+        return _items.ptr() + w * WORD_BITS + index;
+    }
+
+    ///Allocate \a n slots at once, filling whole bitmap words where possible
+    //@param fn callback receiving pointer to uninitialized slot memory, fn(T*)
+    template <class Fn>
+    void add_uninit(uints n, Fn fn)
+    {
+        uints nfree = _items.size() - _count;
+        if (n > nfree) {
+            uints nw = _bmp.size();
+            uints nadd = align_to_chunks(n - nfree, WORD_BITS);
+            grow(nadd > nw ? nadd : nw);
+        }
 
-        return _items.ptr() + (b - _bmp.ptr()) * 32 + index;
+        uints w = 0;
+        while (n > 0) {
+            w = next_word(_free1, _free2, w);
+            DASSERT(w != UINTS_MAX);
+
+            BLOCK_TYPE m = ~_bmp[w];
+            uints nbits = __popcnt64(m);
+
+            if (n < nbits) {
+                //keep only the lowest n free bits
+                BLOCK_TYPE r = m;
+                for (uints i = 0; i < n; ++i)
+                    r &= r - 1;
+                m ^= r;
+                nbits = n;
+            }
+
+            take(w, m);
+            n -= nbits;
+
+            T* base = _items.ptr() + w * WORD_BITS;
+            do {
+                fn(base + lsb_bit_set(m));
+                m &= m - 1;
+            }
+            while (m);
+        }
     }
 
     uints get_item_id(const T * const ptr) const
@@ -88,73 +132,159 @@ public:
 
     bool is_valid(const uints id) const
     {
-        const uints index = id >> 5;
-        const uint block = index < _bmp.size() ? _bmp[index] : 0;
-        return (block & (1 << (id & 31))) != 0;
+        const uints index = id / WORD_BITS;
+        const BLOCK_TYPE block = index < _bmp.size() ? _bmp[index] : 0;
+        return (block & (BLOCK_TYPE(1) << (id % WORD_BITS))) != 0;
     }
 
     void del(const uints id)
-    {        
-        DASSERT((id >> 5) <_bmp.size() && _items.size() != 0);
+    {
+        const uints w = id / WORD_BITS;
+        DASSERT(w < _bmp.size() && _items.size() != 0);
+
+        BLOCK_TYPE& block = _bmp[w];
+        const BLOCK_TYPE slot = BLOCK_TYPE(1) << (id % WORD_BITS);
+
+        DASSERT((block & slot) != 0);
+
+        if (block == FULL)
+            set_bit(_free1, _free2, w);
 
-        BLOCK_TYPE * const block = _bmp.ptr() + (id >> 5);
-        const uint slot = 1 << (id & 31);
-        
-        DASSERT((*block & slot) != 0);
+        block ^= slot;
+        --_count;
 
-        *block ^= slot;
-        
-        _items[id].~T();        
+        if (block == 0)
+            clear_bit(_used1, _used2, w);
+
+        _items[id].~T();
     }
 
     uints first() const
     {
-        const BLOCK_TYPE * b = _bmp.ptr();
-        const BLOCK_TYPE * const be = _bmp.ptre();
-
-        while (b != be && *b == 0)
-            ++b;
-        if (b == be) return -1;
-
-        uchar index = lsb_bit_set(*b);
+        uints w = next_word(_used1, _used2, 0);
+        if (w == UINTS_MAX)
+            return -1;
 
-        return (b - _bmp.ptr()) * 32 + index;
+        return w * WORD_BITS + lsb_bit_set(_bmp[w]);
     }
 
     uints next(uints id) const
     {
         ++id;
 
-        DASSERT(id != UINTS_MAX && id <= _bmp.size() * 32);
+        DASSERT(id != UINTS_MAX && id <= _bmp.size() * WORD_BITS);
+
+        uints w = id / WORD_BITS;
+        if (w == _bmp.size())
+            return -1;
 
-        const BLOCK_TYPE * b = _bmp.ptr() + (id >> 5);
-        const BLOCK_TYPE * const be = _bmp.ptre();
-        uchar index = id & 31;
+        const BLOCK_TYPE tmp = _bmp[w] & (FULL << (id % WORD_BITS));
+        if (tmp)
+            return w * WORD_BITS + lsb_bit_set(tmp);
 
-        if (b == be)
+        w = next_word(_used1, _used2, w + 1);
+        if (w == UINTS_MAX)
             return -1;
 
-        const uint tmp = *b & ~((1 << index) - 1);
-        index = tmp != 0
-            ? lsb_bit_set(tmp)
-            : 32;
+        return w * WORD_BITS + lsb_bit_set(_bmp[w]);
+    }
 
-        if (index == 32) {
-            ++b;
-            while (b != be && *b == 0)
-                ++b;
+    uints size() const { return _items.size(); }
 
-            if (b == be)
-                return -1;
+    //@return number of used slots
+    uints count() const { return _count; }
 
-            index = lsb_bit_set(*b);
+private:
+
+    ///Find first bitmap word at or after \a w with its bit set in the level 1 summary
+    //@return word index or UINTS_MAX
+    static uints next_word(const dynarray<BLOCK_TYPE>& l1, const dynarray<BLOCK_TYPE>& l2, uints w)
+    {
+        uints k = w / WORD_BITS;
+        if (k >= l1.size())
+            return UINTS_MAX;
+
+        BLOCK_TYPE m = l1[k] & (FULL << (w % WORD_BITS));
+        if (!m) {
+            //find next non-zero level 1 word through the level 2 summary
+            uints j = k + 1;
+            uints jw = j / WORD_BITS;
+            if (jw >= l2.size())
+                return UINTS_MAX;
+
+            BLOCK_TYPE m2 = l2[jw] & (FULL << (j % WORD_BITS));
+            while (!m2) {
+                if (++jw >= l2.size())
+                    return UINTS_MAX;
+                m2 = l2[jw];
+            }
+
+            k = jw * WORD_BITS + lsb_bit_set(m2);
+            m = l1[k];
         }
 
-        return (b - _bmp.ptr()) * 32 + index;
+        return k * WORD_BITS + lsb_bit_set(m);
     }
 
-    uints size() const { return _items.size(); }
+    static void set_bit(dynarray<BLOCK_TYPE>& l1, dynarray<BLOCK_TYPE>& l2, uints w)
+    {
+        l1[w / WORD_BITS] |= BLOCK_TYPE(1) << (w % WORD_BITS);
+        w /= WORD_BITS;
+        l2[w / WORD_BITS] |= BLOCK_TYPE(1) << (w % WORD_BITS);
+    }
+
+    static void clear_bit(dynarray<BLOCK_TYPE>& l1, dynarray<BLOCK_TYPE>& l2, uints w)
+    {
+        BLOCK_TYPE& b = l1[w / WORD_BITS];
+        b &= ~(BLOCK_TYPE(1) << (w % WORD_BITS));
+        if (!b) {
+            w /= WORD_BITS;
+            l2[w / WORD_BITS] &= ~(BLOCK_TYPE(1) << (w % WORD_BITS));
+        }
+    }
+
+    ///Mark slots given by mask in bitmap word \a w as used
+    void take(uints w, BLOCK_TYPE mask)
+    {
+        BLOCK_TYPE& block = _bmp[w];
+        DASSERT((block & mask) == 0);
+
+        if (block == 0)
+            set_bit(_used1, _used2, w);
+
+        block |= mask;
+        _count += __popcnt64(mask);
 
+        if (block == FULL)
+            clear_bit(_free1, _free2, w);
+    }
+
+    ///Set free summary bits for bitmap words [from, to)
+    void fill_free_summary(uints from, uints to)
+    {
+        for (uints w = from; w < to; ++w)
+            set_bit(_free1, _free2, w);
+    }
+
+    ///Add \a nwords empty bitmap words
+    void grow(uints nwords)
+    {
+        const uints from = _bmp.size();
+        const uints to = from + nwords;
+
+        memset(_bmp.add_uninit(nwords), 0, nwords * sizeof(BLOCK_TYPE));
+        _items.add_uninit(nwords * WORD_BITS);
+
+        const uints n1 = align_to_chunks(to, WORD_BITS);
+        const uints n2 = align_to_chunks(n1, WORD_BITS);
+
+        _free1.addc(n1 - _free1.size());
+        _used1.addc(n1 - _used1.size());
+        _free2.addc(n2 - _free2.size());
+        _used2.addc(n2 - _used2.size());
+
+        fill_free_summary(from, to);
+    }
 };
 
 namespace test
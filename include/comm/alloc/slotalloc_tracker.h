@@ -39,6 +39,7 @@
 * ***** END LICENSE BLOCK ***** */
 
 #include "../binstring.h"
+#include <atomic>
 
 COID_NAMESPACE_BEGIN
 
@@ -53,6 +54,7 @@ enum class slotalloc_mode
     atomic = 4,             //< ins/del operations are done atomically, one inserter, multiple deleters allowed
     tracking = 8,           //< adds data and methods needed for tracking the modifications
     versioning = 16,        //< adds data and methods needed to track version of array items, to handle cases when a new item occupies the same slot and old references to the slot should be invalid
+    concurrent = 32,        //< lock-free ins/del from multiple threads, requires linear mode and a capacity reserved in advance (implies atomic)
 
     multikey = 128,         //< used by slothash for multi-key value support
 };
@@ -155,6 +157,63 @@ struct storage<true, ATOMIC, T>
 };
 
 #endif //COID_CONSTEXPR_IF
+
+
+///Capacity and per-thread free slot caches for the concurrent mode
+template <bool CONCURRENT>
+struct concurrent_base
+{
+    void swap_hints(concurrent_base& other) {}
+};
+
+template <>
+struct concurrent_base<true>
+{
+    static constexpr uint NHINTS = 16;
+
+    ///Bitmap words where a thread looks for a free slot, one cache line each
+    struct alignas(64) hint {
+        std::atomic<uints> freed;       //< word where the thread deleted an item last time
+        std::atomic<uints> frontier;    //< word the thread allocates from when there are no freed slots
+    };
+
+    hint _hints[NHINTS];
+    uints _capacity = 0;                //< number of slots reserved for the concurrent use
+
+    concurrent_base() {
+        spread_hints(0);
+    }
+
+    //@return allocation hints of the calling thread
+    hint& thread_hint() {
+        return _hints[thread_index() % NHINTS];
+    }
+
+    ///Spread initial hints over the bitmap so that threads start in different words
+    void spread_hints(uints nwords) {
+        for (uint i = 0; i < NHINTS; ++i) {
+            _hints[i].freed.store(UMAXS, std::memory_order_relaxed);
+            _hints[i].frontier.store(nwords * i / NHINTS, std::memory_order_relaxed);
+        }
+    }
+
+    void swap_hints(concurrent_base& other) {
+        for (uint i = 0; i < NHINTS; ++i) {
+            hint& a = _hints[i];
+            hint& b = other._hints[i];
+            a.freed.store(b.freed.exchange(a.freed.load(std::memory_order_relaxed), std::memory_order_relaxed), std::memory_order_relaxed);
+            a.frontier.store(b.frontier.exchange(a.frontier.load(std::memory_order_relaxed), std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        std::swap(_capacity, other._capacity);
+    }
+
+    //@return sequential index of the calling thread
+    static uint thread_index() {
+        static std::atomic<uint> next{0};
+        static thread_local uint index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+};
 
 
 template<class...Es>
@@ -347,6 +406,7 @@ struct base<VERSIONING, true, Es...>
     dynarray<changeset>* get_changeset() { return &std::get<sizeof...(Es)>(this->_exts); }
     const dynarray<changeset>* get_changeset() const { return &std::get<sizeof...(Es)>(this->_exts); }
     uint* get_frame() { return &_frame; }
+    const uint* get_frame() const { return &_frame; }
 
 private:
 
@@ -89,7 +89,7 @@ namespace atomic {
 
 inline coid::int32 inc(volatile coid::int32 * ptr)
 {
-    DASSERT(sizeof(coid::int32) == 4 && sizeof(long) == 4);
+    DASSERT(sizeof(coid::int32) == 4);
 #if defined(SYSTYPE_WIN)
     return _InterlockedIncrement(reinterpret_cast<volatile long*>(ptr));
 #elif defined(__GNUC__)
@@ -103,7 +103,7 @@ inline coid::uint32 inc(volatile coid::uint32 * ptr) {
 
 inline coid::int32 dec(volatile coid::int32 * ptr)
 {
-    DASSERT(sizeof(coid::int32) == 4 && sizeof(long) == 4);
+    DASSERT(sizeof(coid::int32) == 4);
 #if defined(SYSTYPE_WIN)
     return _InterlockedDecrement(reinterpret_cast<volatile long*>(ptr));
 #elif defined(__GNUC__)
@@ -148,7 +148,7 @@ inline coid::uint64 dec(volatile coid::uint64 * ptr) {
 
 inline coid::int32 add(volatile coid::int32 * ptr, const coid::int32 val)
 {
-    DASSERT(sizeof(coid::int32) == 4 && sizeof(long) == 4);
+    DASSERT(sizeof(coid::int32) == 4);
 #if defined(SYSTYPE_WIN)
     return _InterlockedExchangeAdd(
         reinterpret_cast<volatile long*>(ptr), val);
@@ -165,7 +165,7 @@ inline coid::uint32 add(volatile coid::uint32 * ptr, const coid::uint32 val) {
 inline coid::int32 cas(
     volatile coid::int32 * ptr, const coid::int32 val, const coid::int32 cmp)
 {
-    DASSERT(sizeof(coid::int32) == 4 && sizeof(long) == 4);
+    DASSERT(sizeof(coid::int32) == 4);
 #if defined(SYSTYPE_WIN)
     return _InterlockedCompareExchange(
         reinterpret_cast<volatile long*>(ptr), val, cmp);
@@ -177,7 +177,7 @@ inline coid::int32 cas(
 inline bool b_cas(
     volatile coid::int32 * ptr, const coid::int32 val, const coid::int32 cmp)
 {
-    DASSERT(sizeof(coid::int32) == 4 && sizeof(long) == 4);
+    DASSERT(sizeof(coid::int32) == 4);
 #if defined(SYSTYPE_WIN)
     return _InterlockedCompareExchange(
         reinterpret_cast<volatile long*>(ptr), val, cmp) == cmp;
@@ -222,7 +222,12 @@ inline bool b_cas128(
         vall,
         cmp) == 1;
 #elif defined(__GNUC__)
-    return (coid::int64*)__sync_bool_compare_and_swap((__int128_t*)ptr, (__int128_t*)cmp, (__int128_t(valh) << 64) + vall);
+    //same as _InterlockedCompareExchange128, cmp receives the original value
+    const __int128_t expected = *(__int128_t*)cmp;
+    const __int128_t val = (__int128_t(valh) << 64) | __int128_t(coid::uint64(vall));
+    const __int128_t prev = __sync_val_compare_and_swap((volatile __int128_t*)ptr, expected, val);
+    *(__int128_t*)cmp = prev;
+    return prev == expected;
 #endif
 }
 #endif
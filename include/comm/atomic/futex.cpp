@@ -0,0 +1,93 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2020
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include "futex.h"
+
+#if defined(SYSTYPE_WIN)
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#   pragma comment(lib, "Synchronization.lib")
+#elif defined(SYSTYPE_LINUX)
+#   include <linux/futex.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#   include <time.h>
+#   include <errno.h>
+#   include <limits.h>
+#else
+#   include <sched.h>
+#endif
+
+namespace atomic {
+
+////////////////////////////////////////////////////////////////////////////////
+bool futex_wait(const volatile void* addr, coid::uint32 expected, coid::uint timeout_ms)
+{
+#if defined(SYSTYPE_WIN)
+    return WaitOnAddress(const_cast<volatile void*>(addr), &expected, sizeof(expected), timeout_ms) != FALSE
+        || GetLastError() != ERROR_TIMEOUT;
+#elif defined(SYSTYPE_LINUX)
+    timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = long(timeout_ms % 1000) * 1000000;
+
+    long rv = syscall(SYS_futex, const_cast<void*>(addr), FUTEX_WAIT_PRIVATE, expected, &ts, 0, 0);
+    return rv == 0 || errno != ETIMEDOUT;
+#else
+    sched_yield();
+    return true;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void futex_wake_one(const volatile void* addr)
+{
+#if defined(SYSTYPE_WIN)
+    WakeByAddressSingle(const_cast<void*>(addr));
+#elif defined(SYSTYPE_LINUX)
+    syscall(SYS_futex, const_cast<void*>(addr), FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void futex_wake_all(const volatile void* addr)
+{
+#if defined(SYSTYPE_WIN)
+    WakeByAddressAll(const_cast<void*>(addr));
+#elif defined(SYSTYPE_LINUX)
+    syscall(SYS_futex, const_cast<void*>(addr), FUTEX_WAKE_PRIVATE, INT_MAX, 0, 0, 0);
+#endif
+}
+
+} // end of namespace atomic
@@ -0,0 +1,77 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2020
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COMM_ATOMIC_FUTEX_H__
+#define __COMM_ATOMIC_FUTEX_H__
+
+#include "../commtypes.h"
+
+#if defined(SYSTYPE_MSVC)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace atomic {
+
+///Hint to the cpu that we are in a spin-wait loop
+inline void cpu_pause()
+{
+#if defined(SYSTYPE_MSVC) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(SYSTYPE_MSVC) && defined(_M_ARM64)
+    __yield();
+#elif defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+///Block the calling thread while the 32-bit value at addr equals expected
+/// Uses futex on Linux and WaitOnAddress on Windows, elsewhere it just yields
+//@param addr address of a 4-byte aligned 32-bit value
+//@param timeout_ms maximum time to block
+//@return false on timeout, true if woken or the value was different (may be spurious)
+bool futex_wait(const volatile void* addr, coid::uint32 expected, coid::uint timeout_ms);
+
+///Wake one thread blocked in futex_wait on given address
+void futex_wake_one(const volatile void* addr);
+
+///Wake all threads blocked in futex_wait on given address
+void futex_wake_all(const volatile void* addr);
+
+} // end of namespace atomic
+
+#endif // __COMM_ATOMIC_FUTEX_H__
@@ -0,0 +1,198 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2020
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COMM_ATOMIC_WS_DEQUE_H__
+#define __COMM_ATOMIC_WS_DEQUE_H__
+
+#include "../commtypes.h"
+#include "../commassert.h"
+
+#include <atomic>
+
+namespace atomic {
+
+/**
+    Chase-Lev work-stealing deque.
+
+    The owner thread pushes and pops items at the bottom end (LIFO), any other thread
+    can steal items from the top end (FIFO). The circular buffer grows on demand,
+    retired buffers are kept until the deque is destroyed since a concurrent stealer
+    may still be reading from them.
+
+    T must be trivially copyable (usually a pointer).
+
+    @see "Correct and Efficient Work-Stealing for Weak Memory Models", Le et al., 2013
+**/
+template <class T>
+class ws_deque
+{
+    struct buffer
+    {
+        coid::int64 _mask;
+        buffer* _retired;               //< previous buffer, freed with the deque
+        std::atomic<T> _items[1];
+
+        static buffer* create(coid::int64 size, buffer* retired)
+        {
+            DASSERT((size & (size - 1)) == 0);
+
+            void* mem = ::malloc(sizeof(buffer) + (size - 1) * sizeof(std::atomic<T>));
+            buffer* b = static_cast<buffer*>(mem);
+            b->_mask = size - 1;
+            b->_retired = retired;
+            return b;
+        }
+
+        coid::int64 size() const { return _mask + 1; }
+
+        T get(coid::int64 i) const { return _items[i & _mask].load(std::memory_order_relaxed); }
+        void put(coid::int64 i, T v) { _items[i & _mask].store(v, std::memory_order_relaxed); }
+    };
+
+public:
+
+    explicit ws_deque(coid::int64 initial_size = 256)
+        : _top(0)
+        , _bottom(0)
+    {
+        _buffer.store(buffer::create(initial_size, 0), std::memory_order_relaxed);
+    }
+
+    ~ws_deque()
+    {
+        buffer* b = _buffer.load(std::memory_order_relaxed);
+        while (b) {
+            buffer* r = b->_retired;
+            ::free(b);
+            b = r;
+        }
+    }
+
+    ///Push item to the bottom end
+    //@note owner thread only
+    void push(T item)
+    {
+        coid::int64 b = _bottom.load(std::memory_order_relaxed);
+        coid::int64 t = _top.load(std::memory_order_acquire);
+        buffer* a = _buffer.load(std::memory_order_relaxed);
+
+        if (b - t > a->_mask)
+            a = grow(a, t, b);
+
+        a->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    ///Pop item from the bottom end (most recently pushed)
+    //@note owner thread only
+    //@return false if the deque was empty
+    bool pop(T& item)
+    {
+        coid::int64 b = _bottom.load(std::memory_order_relaxed) - 1;
+        buffer* a = _buffer.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        coid::int64 t = _top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            //empty
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = a->get(b);
+
+        if (t == b) {
+            //last item, race against stealers
+            bool won = _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        return true;
+    }
+
+    ///Steal item from the top end (least recently pushed)
+    //@note can be called from any thread
+    //@return false if the deque was empty or the item was taken by a concurrent pop/steal
+    bool steal(T& item)
+    {
+        coid::int64 t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        coid::int64 b = _bottom.load(std::memory_order_acquire);
+
+        if (t >= b)
+            return false;
+
+        buffer* a = _buffer.load(std::memory_order_acquire);
+        item = a->get(t);
+
+        return _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    //@return approximate number of items in the deque
+    coid::int64 size() const
+    {
+        coid::int64 b = _bottom.load(std::memory_order_relaxed);
+        coid::int64 t = _top.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+
+    bool is_empty() const { return size() == 0; }
+
+private:
+
+    ws_deque(const ws_deque&) = delete;
+    ws_deque& operator = (const ws_deque&) = delete;
+
+    buffer* grow(buffer* a, coid::int64 t, coid::int64 b)
+    {
+        buffer* n = buffer::create(a->size() * 2, a);
+        for (coid::int64 i = t; i < b; ++i)
+            n->put(i, a->get(i));
+
+        _buffer.store(n, std::memory_order_release);
+        return n;
+    }
+
+    //top and bottom on separate cache lines, top is hammered by stealers
+    alignas(64) std::atomic<coid::int64> _top;
+    alignas(64) std::atomic<coid::int64> _bottom;
+    alignas(64) std::atomic<buffer*> _buffer;
+};
+
+} // end of namespace atomic
+
+#endif // __COMM_ATOMIC_WS_DEQUE_H__
@@ -0,0 +1,322 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2021
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+/**
+    Hash table microbenchmarks comparing the chained hash_map (with blocking and incremental rehash)
+    with the open-addressing flat_hash_map, results are written as JSON to track regressions between versions.
+
+    usage: hash_bench [--json file] [--quick] [--filter name]
+
+    insert              inserting n unique keys into an empty table
+    insert_worst        worst single insert latency while growing the table
+    find_hit            lookup of keys present in the table
+    find_miss           lookup of keys not present in the table
+    erase               erasing all keys one by one
+    iterate             walking over all elements
+    churn               interleaved erase and insert at a constant size
+
+    Each benchmark runs with integer and string keys, for several table sizes.
+**/
+
+#include "../hash/hashmap.h"
+#include "../hash/flathashmap.h"
+#include "../hash/hashset.h"
+#include "../str.h"
+#include "../timer.h"
+#include "../rnd.h"
+
+#include <cstdio>
+
+using namespace coid;
+
+////////////////////////////////////////////////////////////////////////////////
+static uint64 now_ns()
+{
+    return nsec_timer::current_time_ns();
+}
+
+///Benchmark settings and JSON output
+struct bench_context
+{
+    bool quick = false;
+    token filter;
+
+    charstr json;
+    bool first_record = true;
+
+    bool enabled(const token& name) const { return filter.is_empty() || filter == name; }
+
+    ///Start a result record
+    void begin(const char* bench, const char* table, const char* key, uints n)
+    {
+        json << (first_record ? "\n" : ",\n") << "    { \"bench\": \"" << bench << "\", \"table\": \"" << table
+            << "\", \"key\": \"" << key << "\", \"size\": " << n;
+        first_record = false;
+        fprintf(stderr, "%s/%s/%s/%u:", bench, table, key, uint(n));
+    }
+
+    void value(const char* name, double v)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.6g", v);
+        json << ", \"" << name << "\": " << buf;
+        fprintf(stderr, " %s=%s", name, buf);
+    }
+
+    void end()
+    {
+        json << " }";
+        fprintf(stderr, "\n");
+    }
+};
+
+///Prevent the optimizer from discarding results
+static volatile uints sink;
+
+////////////////////////////////////////////////////////////////////////////////
+///Key sets, the second half is used for misses
+static void make_keys(dynarray<uint>& keys, uints n)
+{
+    rnd_strong rnd(1234);
+    hash_set<uint> unique;
+    keys.reserve(2 * n, false);
+
+    while (keys.size() < 2 * n) {
+        uint k = rnd.rand();
+        if (unique.insert_value(k))
+            *keys.add() = k;
+    }
+}
+
+static void make_keys(dynarray<charstr>& keys, uints n)
+{
+    dynarray<uint> ikeys;
+    make_keys(ikeys, n);
+
+    keys.alloc(ikeys.size());
+    for (uints i = 0; i < ikeys.size(); ++i)
+        keys[i] << "entity/" << ikeys[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Run all benchmarks for one table type
+//@param table table name for the output
+//@param key key type name for the output
+template <class MAP, class KEY>
+static void run_table(bench_context& ctx, const char* table, const char* key, const dynarray<KEY>& keys, uints n)
+{
+    const uints reps = ctx.quick ? 1 : (n < 10000 ? 200 : (n < 200000 ? 5 : 1));
+    const double nops = double(n) * reps;
+
+    MAP map;
+    uint64 t;
+
+    if (ctx.enabled("insert_worst")) {
+        uint64 worst = 0;
+        for (uints r = 0; r < reps; ++r) {
+            MAP m;
+            for (uints i = 0; i < n; ++i) {
+                t = now_ns();
+                m.insert_key_value(keys[i], int(i));
+                t = now_ns() - t;
+                if (t > worst)
+                    worst = t;
+            }
+        }
+        ctx.begin("insert_worst", table, key, n);
+        ctx.value("us", worst / 1000.0);
+        ctx.end();
+    }
+
+    if (ctx.enabled("insert")) {
+        uint64 total = 0;
+        for (uints r = 0; r < reps; ++r) {
+            MAP m;
+            t = now_ns();
+            for (uints i = 0; i < n; ++i)
+                m.insert_key_value(keys[i], int(i));
+            total += now_ns() - t;
+        }
+        ctx.begin("insert", table, key, n);
+        ctx.value("ns_per_op", total / nops);
+        ctx.end();
+    }
+
+    for (uints i = 0; i < n; ++i)
+        map.insert_key_value(keys[i], int(i));
+
+    if (ctx.enabled("find_hit")) {
+        uints found = 0;
+        t = now_ns();
+        for (uints r = 0; r < reps; ++r)
+            for (uints i = 0; i < n; ++i)
+                found += map.find_value(keys[i]) != 0;
+        t = now_ns() - t;
+        sink = found;
+
+        ctx.begin("find_hit", table, key, n);
+        ctx.value("ns_per_op", t / nops);
+        ctx.end();
+    }
+
+    if (ctx.enabled("find_miss")) {
+        uints found = 0;
+        t = now_ns();
+        for (uints r = 0; r < reps; ++r)
+            for (uints i = n; i < 2 * n; ++i)
+                found += map.find_value(keys[i]) != 0;
+        t = now_ns() - t;
+        sink = found;
+
+        ctx.begin("find_miss", table, key, n);
+        ctx.value("ns_per_op", t / nops);
+        ctx.end();
+    }
+
+    if (ctx.enabled("iterate")) {
+        uints sum = 0;
+        t = now_ns();
+        for (uints r = 0; r < reps; ++r)
+            for (const auto& v : map)
+                sum += v.second;
+        t = now_ns() - t;
+        sink = sum;
+
+        ctx.begin("iterate", table, key, n);
+        ctx.value("ns_per_op", t / nops);
+        ctx.end();
+    }
+
+    if (ctx.enabled("churn")) {
+        //replace the first half of keys with the second half and back
+        t = now_ns();
+        for (uints r = 0; r < reps; ++r) {
+            uints from = (r & 1) ? n : 0;
+            uints to = (r & 1) ? 0 : n;
+            for (uints i = 0; i < n; ++i) {
+                map.erase(keys[from + i]);
+                map.insert_key_value(keys[to + i], int(i));
+            }
+        }
+        t = now_ns() - t;
+
+        ctx.begin("churn", table, key, n);
+        ctx.value("ns_per_op", t / nops);
+        ctx.end();
+
+        if (reps & 1) {
+            for (uints i = 0; i < n; ++i) {
+                map.erase(keys[n + i]);
+                map.insert_key_value(keys[i], int(i));
+            }
+        }
+    }
+
+    if (ctx.enabled("erase")) {
+        t = now_ns();
+        for (uints i = 0; i < n; ++i)
+            map.erase(keys[i]);
+        t = now_ns() - t;
+
+        ctx.begin("erase", table, key, n);
+        ctx.value("ns_per_op", t / double(n));
+        ctx.end();
+    }
+}
+
+///Chained hash_map migrating the buckets gradually after growing
+template <class KEY>
+struct hash_map_incremental : hash_map<KEY, int>
+{
+    hash_map_incremental() {
+        this->set_incremental_rehash(8);
+    }
+};
+
+template <class KEY>
+static void run_key(bench_context& ctx, const char* key, uints n)
+{
+    dynarray<KEY> keys;
+    make_keys(keys, n);
+
+    run_table<hash_map<KEY, int>>(ctx, "chained", key, keys, n);
+    run_table<hash_map_incremental<KEY>>(ctx, "chained_incremental", key, keys, n);
+    run_table<flat_hash_map<KEY, int>>(ctx, "flat", key, keys, n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    bench_context ctx;
+    const char* json_path = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        token arg = argv[i];
+        if (arg == "--json"_T && i + 1 < argc)
+            json_path = argv[++i];
+        else if (arg == "--filter"_T && i + 1 < argc)
+            ctx.filter = argv[++i];
+        else if (arg == "--quick"_T)
+            ctx.quick = true;
+        else {
+            fprintf(stderr, "usage: %s [--json file] [--quick] [--filter name]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    ctx.json << "{\n  \"suite\": \"hash\",\n  \"format\": 1,\n  \"quick\": " << (ctx.quick ? "true" : "false")
+        << ",\n  \"results\": [";
+
+    static const uints sizes[] = { 1000, 100000, 1000000 };
+
+    for (uints n : sizes) {
+        if (ctx.quick && n > 100000)
+            break;
+        run_key<uint>(ctx, "uint", n);
+        run_key<charstr>(ctx, "string", n);
+    }
+
+    ctx.json << "\n  ]\n}\n";
+
+    FILE* f = json_path ? fopen(json_path, "wb") : stdout;
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", json_path);
+        return 1;
+    }
+    fwrite(ctx.json.ptr(), 1, ctx.json.len(), f);
+    if (f != stdout)
+        fclose(f);
+
+    return 0;
+}
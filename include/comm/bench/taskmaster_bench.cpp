@@ -0,0 +1,528 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2020
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+/**
+    Taskmaster microbenchmarks, results are written as JSON to track regressions between versions.
+
+    usage: taskmaster_bench [--json file] [--workers n] [--quick] [--filter name]
+
+    push_pop            throughput of empty tasks pushed from a non-worker and from a worker thread
+    fanout_fanin        latency of pushing a batch of tasks and waiting for them, 1..N producer threads
+    parallel_for        scaling of parallel_for with the number of workers
+    nested_wait         cost of tasks waiting for their child tasks
+    priority            latency of HIGH tasks while LOW tasks flood the workers
+    wait_wake           wake latency and cpu burn of wait() compared to a yield loop
+**/
+
+#include "../taskmaster.h"
+#include "../str.h"
+#include "../timer.h"
+
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#ifdef SYSTYPE_WIN
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+using namespace coid;
+
+typedef taskmaster::EPriority EPriority;
+typedef taskmaster::EScheduling EScheduling;
+
+////////////////////////////////////////////////////////////////////////////////
+static uint64 now_ns()
+{
+    return nsec_timer::current_time_ns();
+}
+
+static uint64 thread_cpu_time_ns()
+{
+#ifdef SYSTYPE_WIN
+    FILETIME ct, et, kt, ut;
+    GetThreadTimes(GetCurrentThread(), &ct, &et, &kt, &ut);
+    return ((uint64(kt.dwHighDateTime) << 32 | kt.dwLowDateTime) + (uint64(ut.dwHighDateTime) << 32 | ut.dwLowDateTime)) * 100;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return uint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static const char* mode_name(EScheduling mode)
+{
+    return mode == EScheduling::WORK_STEALING ? "work_stealing" : "shared_queue";
+}
+
+///Percentile of samples, sorts the array
+static uint64 percentile(dynarray<uint64>& samples, uint pct)
+{
+    if (samples.size() == 0)
+        return 0;
+
+    std::sort(samples.ptr(), samples.ptre());
+    return samples[(samples.size() - 1) * pct / 100];
+}
+
+static uint64 average(const dynarray<uint64>& samples)
+{
+    uint64 sum = 0;
+    for (uint64 v : samples)
+        sum += v;
+    return samples.size() ? sum / samples.size() : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Benchmark settings and JSON output
+struct bench_context
+{
+    uint nworkers = 4;
+    bool quick = false;
+    token filter;
+
+    charstr json;
+    bool first_record = true;
+    bool first_value = true;
+
+    //@return number of iterations, reduced in quick mode
+    uint iterations(uint n) const { return quick ? (n / 10 > 0 ? n / 10 : 1) : n; }
+
+    bool enabled(const token& name) const { return filter.is_empty() || filter == name; }
+
+    ///Start a result record
+    void begin(const char* bench, EScheduling mode)
+    {
+        json << (first_record ? "\n" : ",\n") << "    { \"bench\": \"" << bench << "\", \"mode\": \"" << mode_name(mode) << "\"";
+        first_record = false;
+        fprintf(stderr, "%s/%s:", bench, mode_name(mode));
+    }
+
+    void value(const char* name, double v)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.6g", v);
+        json << ", \"" << name << "\": " << buf;
+        fprintf(stderr, " %s=%s", name, buf);
+    }
+
+    void end()
+    {
+        json << " }";
+        fprintf(stderr, "\n");
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///Throughput of empty tasks
+static void bench_push_pop(bench_context& ctx, EScheduling mode)
+{
+    taskmaster tm(ctx.nworkers, ctx.nworkers, mode);
+    const uint ntasks = ctx.iterations(200000);
+
+    //from a non-worker thread
+    taskmaster::signal_handle signal;
+    uint64 t0 = now_ns();
+    for (uint i = 0; i < ntasks; ++i)
+        tm.push(EPriority::HIGH, &signal, []() {});
+    const uint64 tpush = now_ns() - t0;
+    tm.wait(signal);
+    const uint64 tall = now_ns() - t0;
+
+    //batched
+    t0 = now_ns();
+    tm.push_many(EPriority::HIGH, &signal, ntasks, [](uints) {});
+    tm.wait(signal);
+    const uint64 tbatch = now_ns() - t0;
+
+    //from a worker, tasks go to its own deque in work stealing mode
+    uint64 tworker = 0;
+    tm.push(EPriority::HIGH, &signal, [&]() {
+        taskmaster::signal_handle inner;
+        const uint64 w0 = now_ns();
+        for (uint i = 0; i < ntasks; ++i)
+            tm.push(EPriority::HIGH, &inner, []() {});
+        tm.wait(inner);
+        tworker = now_ns() - w0;
+    });
+    tm.wait(signal);
+
+    ctx.begin("push_pop", mode);
+    ctx.value("tasks", ntasks);
+    ctx.value("push_ns_per_task", double(tpush) / ntasks);
+    ctx.value("ns_per_task", double(tall) / ntasks);
+    ctx.value("batched_ns_per_task", double(tbatch) / ntasks);
+    ctx.value("worker_ns_per_task", double(tworker) / ntasks);
+    ctx.value("tasks_per_sec", ntasks * 1e9 / double(tall));
+    ctx.end();
+
+    tm.terminate(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Latency of pushing a batch of tasks and waiting for them, with concurrent producers
+static void bench_fanout_fanin(bench_context& ctx, EScheduling mode)
+{
+    taskmaster tm(ctx.nworkers, ctx.nworkers, mode);
+
+    const uint nrounds = ctx.iterations(2000);
+    const uint fanout = 64;
+
+    for (uint nproducers = 1; ; nproducers *= 2) {
+        if (nproducers > ctx.nworkers)
+            nproducers = ctx.nworkers;
+
+        dynarray<dynarray<uint64>> samples;
+        samples.alloc(nproducers);
+
+        dynarray<std::thread> producers;
+        producers.alloc(nproducers);
+
+        for (uint p = 0; p < nproducers; ++p) {
+            producers[p] = std::thread([&, p]() {
+                dynarray<uint64>& lat = samples[p];
+                lat.alloc(nrounds);
+
+                for (uint r = 0; r < nrounds; ++r) {
+                    taskmaster::signal_handle signal;
+                    const uint64 t0 = now_ns();
+                    for (uint i = 0; i < fanout; ++i)
+                        tm.push(EPriority::HIGH, &signal, []() {});
+                    tm.wait(signal);
+                    lat[r] = now_ns() - t0;
+                }
+            });
+        }
+
+        for (std::thread& t : producers)
+            t.join();
+
+        dynarray<uint64> all;
+        for (const dynarray<uint64>& s : samples)
+            all.append(s);
+
+        ctx.begin("fanout_fanin", mode);
+        ctx.value("producers", nproducers);
+        ctx.value("fanout", fanout);
+        ctx.value("avg_us", average(all) * 1e-3);
+        ctx.value("p50_us", percentile(all, 50) * 1e-3);
+        ctx.value("p99_us", percentile(all, 99) * 1e-3);
+        ctx.end();
+
+        if (nproducers == ctx.nworkers)
+            break;
+    }
+
+    tm.terminate(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Scaling of parallel_for with the number of workers
+static void bench_parallel_for(bench_context& ctx, EScheduling mode)
+{
+    const uint n = ctx.iterations(2000000);
+    dynarray<float> data;
+    data.alloc(n);
+
+    double base_ms = 0;
+
+    for (uint nworkers = 1; ; nworkers *= 2) {
+        if (nworkers > ctx.nworkers)
+            nworkers = ctx.nworkers;
+
+        taskmaster tm(nworkers, nworkers, mode);
+
+        uint64 best = UINT64_MAX;
+        for (int rep = 0; rep < 5; ++rep) {
+            const uint64 t0 = now_ns();
+            tm.parallel_for(uint(0), n, [&data](uint i) {
+                float x = float(i);
+                for (int k = 0; k < 16; ++k)
+                    x = std::sqrt(x + float(k));
+                data[i] = x;
+            });
+            const uint64 t = now_ns() - t0;
+            if (t < best)
+                best = t;
+        }
+
+        const double ms = best * 1e-6;
+        if (nworkers == 1)
+            base_ms = ms;
+
+        ctx.begin("parallel_for", mode);
+        ctx.value("workers", nworkers);
+        ctx.value("items", n);
+        ctx.value("ms", ms);
+        ctx.value("speedup", base_ms / ms);
+        ctx.end();
+
+        tm.terminate(true);
+
+        if (nworkers == ctx.nworkers)
+            break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Tasks that spawn child tasks and wait for them
+static void bench_nested_wait(bench_context& ctx, EScheduling mode)
+{
+    taskmaster tm(ctx.nworkers, ctx.nworkers, mode);
+
+    const uint fanout = 8;
+    const uint depth = ctx.quick ? 4 : 5;
+
+    struct node {
+        static void run(taskmaster& tm, uint fanout, uint depth, std::atomic<uint>& count) {
+            ++count;
+            if (depth == 0)
+                return;
+
+            taskmaster::signal_handle children;
+            for (uint i = 0; i < fanout; ++i)
+                tm.push(EPriority::HIGH, &children, [&tm, fanout, depth, &count]() {
+                    run(tm, fanout, depth - 1, count);
+                });
+            tm.wait(children);
+        }
+    };
+
+    std::atomic<uint> count(0);
+    uint64 best = UINT64_MAX;
+
+    for (int rep = 0; rep < 3; ++rep) {
+        count = 0;
+        const uint64 t0 = now_ns();
+        node::run(tm, fanout, depth, count);
+        const uint64 t = now_ns() - t0;
+        if (t < best)
+            best = t;
+    }
+
+    ctx.begin("nested_wait", mode);
+    ctx.value("fanout", fanout);
+    ctx.value("depth", depth);
+    ctx.value("tasks", count);
+    ctx.value("ns_per_task", double(best) / count);
+    ctx.end();
+
+    tm.terminate(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Latency of HIGH priority tasks while LOW priority tasks keep the workers busy
+static void bench_priority(bench_context& ctx, EScheduling mode)
+{
+    const uint nlow = ctx.nworkers > 1 ? ctx.nworkers / 2 : 1;
+    taskmaster tm(ctx.nworkers, nlow, mode);
+
+    const uint nsamples = ctx.iterations(1000);
+
+    for (int flood = 0; flood < 2; ++flood)
+    {
+        std::atomic<bool> stop(false);
+        std::atomic<uint> nlow_done(0);
+        taskmaster::signal_handle low;
+
+        struct busy {
+            static void run(taskmaster& tm, std::atomic<bool>& stop, std::atomic<uint>& done, taskmaster::signal_handle* low) {
+                const uint64 t0 = now_ns();
+                while (now_ns() - t0 < 50000)
+                    atomic::cpu_pause();
+                ++done;
+                if (!stop)
+                    tm.push(EPriority::LOW, low, [&tm, &stop, &done, low]() { run(tm, stop, done, low); });
+            }
+        };
+
+        if (flood) {
+            for (uint i = 0; i < 4 * ctx.nworkers; ++i)
+                tm.push(EPriority::LOW, &low, [&tm, &stop, &nlow_done, &low]() {
+                    busy::run(tm, stop, nlow_done, &low);
+                });
+        }
+
+        dynarray<uint64> lat;
+        lat.alloc(nsamples);
+
+        const uint64 t0 = now_ns();
+        for (uint i = 0; i < nsamples; ++i) {
+            taskmaster::signal_handle signal;
+            std::atomic<uint64> started(0);
+            const uint64 pushed = now_ns();
+            tm.push(EPriority::HIGH, &signal, [&started]() { started = now_ns(); });
+            tm.wait(signal);
+            lat[i] = started - pushed;
+
+            thread::wait(0);
+        }
+        const uint64 elapsed = now_ns() - t0;
+
+        stop = true;
+        if (flood)
+            tm.wait(low);
+
+        ctx.begin("priority", mode);
+        ctx.value("low_flood", flood);
+        ctx.value("high_avg_us", average(lat) * 1e-3);
+        ctx.value("high_p99_us", percentile(lat, 99) * 1e-3);
+        ctx.value("low_tasks_per_sec", nlow_done * 1e9 / double(elapsed));
+        ctx.end();
+    }
+
+    tm.terminate(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Wake latency and cpu burn of a thread waiting for a signal triggered by another thread
+/// Compares taskmaster::wait (spin, yield, park) with a plain yield loop
+static void bench_wait_wake(bench_context& ctx, EScheduling mode)
+{
+    taskmaster tm(2, 1, mode);
+
+    const uint nrounds = ctx.iterations(200);
+    const uint delay_ms = 2;
+
+    for (int yield_loop = 0; yield_loop < 2; ++yield_loop)
+    {
+        dynarray<uint64> lat;
+        lat.alloc(nrounds);
+        uint64 cpu = 0, wall = 0;
+
+        for (uint i = 0; i < nrounds; ++i) {
+            taskmaster::signal_handle signal = tm.create_signal();
+            std::atomic<uint64> triggered(0);
+
+            std::thread producer([&]() {
+                thread::wait(delay_ms);
+                triggered = now_ns();
+                tm.trigger_signal(signal);
+            });
+
+            const uint64 c0 = thread_cpu_time_ns();
+            const uint64 t0 = now_ns();
+
+            if (yield_loop) {
+                while (!triggered)
+                    thread::wait(0);
+            }
+            else
+                tm.wait(signal);
+
+            const uint64 t1 = now_ns();
+            cpu += thread_cpu_time_ns() - c0;
+            wall += t1 - t0;
+
+            producer.join();
+
+            lat[i] = t1 > triggered ? t1 - triggered : 0;
+        }
+
+        ctx.begin(yield_loop ? "wait_wake_yield_loop" : "wait_wake", mode);
+        ctx.value("avg_us", average(lat) * 1e-3);
+        ctx.value("max_us", percentile(lat, 100) * 1e-3);
+        ctx.value("cpu_burn_pct", wall ? cpu * 100.0 / wall : 0);
+        ctx.end();
+    }
+
+    tm.terminate(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    bench_context ctx;
+    const char* json_path = 0;
+
+    uint hw = std::thread::hardware_concurrency();
+    ctx.nworkers = hw > 1 ? hw : 1;
+
+    for (int i = 1; i < argc; ++i) {
+        token arg = argv[i];
+        if (arg == "--json"_T && i + 1 < argc)
+            json_path = argv[++i];
+        else if (arg == "--workers"_T && i + 1 < argc)
+            ctx.nworkers = uint_max(1U, uint(atoi(argv[++i])));
+        else if (arg == "--filter"_T && i + 1 < argc)
+            ctx.filter = argv[++i];
+        else if (arg == "--quick"_T)
+            ctx.quick = true;
+        else {
+            fprintf(stderr, "usage: %s [--json file] [--workers n] [--quick] [--filter name]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    ctx.json << "{\n  \"suite\": \"taskmaster\",\n  \"format\": 1,\n  \"hardware_threads\": " << hw
+        << ",\n  \"workers\": " << ctx.nworkers << ",\n  \"quick\": " << (ctx.quick ? "true" : "false")
+        << ",\n  \"results\": [";
+
+    typedef void (*bench_fn)(bench_context&, EScheduling);
+    static const struct {
+        const char* name;
+        bench_fn fn;
+    } benches[] = {
+        { "push_pop", &bench_push_pop },
+        { "fanout_fanin", &bench_fanout_fanin },
+        { "parallel_for", &bench_parallel_for },
+        { "nested_wait", &bench_nested_wait },
+        { "priority", &bench_priority },
+        { "wait_wake", &bench_wait_wake },
+    };
+
+    for (const auto& b : benches) {
+        if (!ctx.enabled(b.name))
+            continue;
+        for (int mode = 0; mode < (int)EScheduling::COUNT; ++mode)
+            b.fn(ctx, EScheduling(mode));
+    }
+
+    ctx.json << "\n  ]\n}\n";
+
+    FILE* f = json_path ? fopen(json_path, "wb") : stdout;
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", json_path);
+        return 1;
+    }
+    fwrite(ctx.json.ptr(), 1, ctx.json.len(), f);
+    if (f != stdout)
+        fclose(f);
+
+    return 0;
+}
@@ -44,6 +44,12 @@
 #include <atomic>
 #endif
 
+#if defined(__AVX2__) || defined(__AVX__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
 
 ////////////////////////////////////////////////////////////////////////////////
 ///Bit scan
@@ -332,6 +338,76 @@ uint clear_bitrange( uints from, uints n, T* ptr )
     return count;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+///Bitmap scanning
+/// Empty regions are skipped 256 bits at a time with AVX2, SSE4.1 or SSE2 (whichever the
+/// compiler targets), with a scalar fallback on other platforms
+
+//@return pointer to the first non-zero word in range, or end if there's none
+template <class T>
+inline const T* find_nonzero_word( const T* p, const T* end )
+{
+    using U = underlying_bitrange_type_t<T>;
+    static_assert(sizeof(U) == sizeof(T), "unexpected word layout");
+
+    static const int N = 32 / sizeof(T);    //words per 256 bits
+
+    for (; end - p >= N; p += N) {
+#if defined(__AVX2__)
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        if (!_mm256_testz_si256(v, v))
+            break;
+#elif defined(__AVX__) || defined(__SSE4_1__)
+        __m128i v = _mm_or_si128(_mm_loadu_si128((const __m128i*)p), _mm_loadu_si128((const __m128i*)p + 1));
+        if (!_mm_testz_si128(v, v))
+            break;
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        __m128i v = _mm_or_si128(_mm_loadu_si128((const __m128i*)p), _mm_loadu_si128((const __m128i*)p + 1));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xffff)
+            break;
+#else
+        U v = 0;
+        for (int i = 0; i < N; ++i)
+            v |= U(p[i]);
+        if (v)
+            break;
+#endif
+    }
+
+    //locate the word within the 256 bit block, or scan the tail
+    for (; p < end && U(*p) == 0; ++p);
+    return p;
+}
+
+//@return pointer to the first 16 bit value in range that has any of the mask bits set, or end if there's none
+inline const uint16* find_masked_uint16( const uint16* p, const uint16* end, uint16 mask )
+{
+#if defined(__AVX2__)
+    const __m256i m = _mm256_set1_epi16(short(mask));
+    for (; end - p >= 16; p += 16) {
+        if (!_mm256_testz_si256(_mm256_loadu_si256((const __m256i*)p), m))
+            break;
+    }
+#elif defined(__AVX__) || defined(__SSE4_1__)
+    const __m128i m = _mm_set1_epi16(short(mask));
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_or_si128(_mm_loadu_si128((const __m128i*)p), _mm_loadu_si128((const __m128i*)p + 1));
+        if (!_mm_testz_si128(v, m))
+            break;
+    }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    const __m128i m = _mm_set1_epi16(short(mask));
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_or_si128(_mm_loadu_si128((const __m128i*)p), _mm_loadu_si128((const __m128i*)p + 1));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, m), _mm_setzero_si128())) != 0xffff)
+            break;
+    }
+#endif
+
+    for (; p < end && (*p & mask) == 0; ++p);
+    return p;
+}
+
 #endif
 
 COID_NAMESPACE_END
@@ -1,7 +1,17 @@
 
 #include "../taskmaster.h"
+#include "../coro.h"
 #include "../log/logger.h"
 
+#include <thread>
+
+#ifdef SYSTYPE_WIN
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 struct jobtest
 {
     void func(int a, void* b) {
@@ -9,6 +19,45 @@ struct jobtest
     }
 };
 
+#ifdef COID_HAS_COROUTINES
+static coid::task<int> coro_add(coid::taskmaster& tm, int a, int b)
+{
+    coid::taskmaster::signal_handle sig;
+    tm.push(coid::taskmaster::EPriority::HIGH, &sig, [](){});
+    co_await sig;
+    co_return a + b;
+}
+
+static coid::task<> coro_sum(coid::taskmaster& tm, volatile int32& out)
+{
+    coid::task<int> x = coro_add(tm, 1, 2), y = coro_add(tm, 3, 4);
+    co_await coid::when_all(x, y);
+    out = x.get() + y.get() + co_await coro_add(tm, 5, 6);
+}
+
+static coid::task<int> coro_delay(coid::taskmaster& tm, int ms, std::atomic_int& finished)
+{
+    coid::taskmaster::signal_handle sig;
+    tm.push(coid::taskmaster::EPriority::HIGH, &sig, [ms]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    });
+    co_await sig;
+    ++finished;
+    co_return ms;
+}
+
+static coid::task<> coro_first(coid::taskmaster& tm, volatile int32& out, std::atomic_int& finished)
+{
+    const int a = co_await coid::when_any(coro_delay(tm, 200, finished), coro_delay(tm, 0, finished));
+
+    coid::dynarray<coid::task<int>> tasks;
+    *tasks.add() = coro_delay(tm, 0, finished);
+    *tasks.add() = coro_delay(tm, 200, finished);
+    const int b = co_await coid::when_any(std::move(tasks));
+
+    out = a * 10 + b;
+}
+#endif
 
 void test_job_queue()
 {
@@ -74,5 +123,212 @@ void test_job_queue()
 
     task.terminate(true);
 
+    coid::taskmaster wstask(7, 2, coid::taskmaster::EScheduling::WORK_STEALING);
+
+    wstask.push(coid::taskmaster::EPriority::LOW, nullptr, job1, 3, nullptr);
+    wstask.push_memberfn(coid::taskmaster::EPriority::NORMAL, nullptr, &jobtest::func, &jt, 4, nullptr);
+
+    volatile int32 sum = 0;
+    wstask.parallel_for(0, 100, [&](int i) {
+        atomic::add(&sum, i);
+    });
+    DASSERT(sum == 4950);
+
+    sum = 0;
+    wstask.parallel_for(0, 1000, 16, [&](int b, int e) {
+        DASSERT(e - b <= 16);
+        for (; b < e; ++b)
+            atomic::add(&sum, b);
+    });
+    DASSERT(sum == 499500);
+
+    //sub-ranges inherit the priority of the task calling parallel_for
+    coid::taskmaster::signal_handle lowfor;
+    sum = 0;
+    wstask.push(coid::taskmaster::EPriority::LOW, &lowfor, [&]() {
+        wstask.parallel_for(0, 1000, 16, [&](int b, int e) {
+            if (coid::taskmaster::current_priority() == coid::taskmaster::EPriority::LOW)
+                atomic::add(&sum, e - b);
+        });
+    });
+    wstask.wait(lowfor);
+    DASSERT(sum == 1000);
+
+    coid::taskmaster::signal_handle first, second;
+    volatile int32 stage = 0;
+    wstask.push(coid::taskmaster::EPriority::NORMAL, &first, [&]() { stage = 1; });
+    wstask.then(first, coid::taskmaster::EPriority::NORMAL, &second, [&]() {
+        DASSERT(stage == 1);
+        stage = 2;
+    });
+    wstask.wait(second);
+    DASSERT(stage == 2);
+
+    sum = 0;
+    coid::taskmaster::signal_handle batch;
+    wstask.push_many(coid::taskmaster::EPriority::HIGH, &batch, 100, [&](uints i) {
+        atomic::add(&sum, int32(i));
+    });
+    wstask.wait(batch);
+    DASSERT(sum == 4950);
+
+    //deadline tasks, served earliest deadline first
+    coid::taskmaster::signal_handle late;
+    const uint64 now = coid::nsec_timer::current_time_ns();
+    sum = 0;
+    for (int i = 0; i < 10; ++i)
+        wstask.push_deadline(now + i * 1000000, coid::taskmaster::EPriority::LOW, &late, [&]() {
+            atomic::inc(&sum);
+        });
+    wstask.wait(late);
+    DASSERT(sum == 10);
+
+    //LOW deadline task with the lead time covering its whole budget is urgent and preempts a HIGH flood
+    coid::taskmaster::signal_handle flood, urgent;
+    volatile int32 nflood = 0, ranat = -1;
+    wstask.push_many(coid::taskmaster::EPriority::HIGH, &flood, 2000, [&](uints) {
+        const uint64 t = coid::nsec_timer::current_time_ns();
+        while (coid::nsec_timer::current_time_ns() - t < 20000);
+        atomic::inc(&nflood);
+    });
+    wstask.push_deadline(coid::nsec_timer::current_time_ns() + 100000000, 100000000, coid::taskmaster::EPriority::LOW, &urgent, [&]() {
+        ranat = nflood;
+    });
+    wstask.wait(urgent);
+    wstask.wait(flood);
+    DASSERT(ranat >= 0 && ranat < 2000);
+
+    //cancelled tasks are skipped but still release the signal
+    coid::taskmaster::signal_handle gate = wstask.create_signal(), dropped;
+    sum = 0;
+    for (int i = 0; i < 10; ++i)
+        wstask.then(gate, coid::taskmaster::EPriority::LOW, &dropped, [&]() {
+            atomic::inc(&sum);
+        });
+    wstask.cancel(dropped);
+    wstask.trigger_signal(gate);
+    wstask.wait(dropped);
+    DASSERT(sum == 0);
+
+    //parallel algorithms
+    coid::dynarray<int> values;
+    values.alloc(10000);
+    for (uints k = 0; k < values.size(); ++k)
+        values[k] = int((k * 7919) % 10000);
+
+    const int64 total = wstask.parallel_reduce(values, int64(0), [](int* b, int* e, int64& acc) {
+        for (; b != e; ++b)
+            acc += *b;
+    }, [](int64& acc, const int64& v) { acc += v; });
+    DASSERT(total == 49995000);
+
+    wstask.parallel_sort(values);
+    DASSERT(values[0] == 0 && values[9999] == 9999);
+
+    wstask.parallel_inclusive_scan(values, coid::taskmaster::fixed_partitioner(256), 0, [](int a, int b) { return a + b; });
+    DASSERT(values[9999] == 49995000);
+
+    //parallel iteration over slotalloc
+    coid::slotalloc_tracking<int> items;
+    for (int k = 0; k < 10000; ++k)
+        *items.add() = k;
+
+    items.advance_frame();
+    items.parallel_for_each(wstask, [](int& v) { v *= 2; });
+
+    std::atomic<int64> msum{0};
+    items.parallel_for_each_modified(wstask, 1, [&](const int* p, uints id) {
+        if (p)
+            msum += *p;
+    });
+    DASSERT(msum == 2 * 49995000);
+
+#ifdef COID_HAS_COROUTINES
+    coid::taskmaster::signal_handle coro_done;
+    sum = 0;
+    coid::spawn(wstask, coid::taskmaster::EPriority::NORMAL, &coro_done, coro_sum(wstask, sum));
+    wstask.wait(coro_done);
+    DASSERT(sum == 21);
+
+    //when_any resumes on the first finished task, the other ones keep running
+    std::atomic_int finished{0};
+    sum = -1;
+    coid::spawn(wstask, coid::taskmaster::EPriority::NORMAL, &coro_done, coro_first(wstask, sum, finished));
+    wstask.wait(coro_done);
+    DASSERT(sum == 10);
+
+    while (finished < 4)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+
+    wstask.terminate(true);
+
     //task.invoke();
 }
+
+////////////////////////////////////////////////////////////////////////////////
+static uint64 thread_cpu_time_ns()
+{
+#ifdef SYSTYPE_WIN
+    FILETIME ct, et, kt, ut;
+    GetThreadTimes(GetCurrentThread(), &ct, &et, &kt, &ut);
+    return ((uint64(kt.dwHighDateTime) << 32 | kt.dwLowDateTime) + (uint64(ut.dwHighDateTime) << 32 | ut.dwLowDateTime)) * 100;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return uint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+///Wake-up latency and cpu burn of a thread waiting for a signal triggered by another thread
+/// Compares taskmaster::wait (spin, yield, park) with a plain yield loop
+void bench_job_wait()
+{
+    coid::taskmaster tm(2, 1, coid::taskmaster::EScheduling::WORK_STEALING);
+
+    const int nrounds = 200;
+    const uint delay_ms = 2;
+
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        uint64 latency = 0, max_latency = 0, cpu = 0, wall = 0;
+
+        for (int i = 0; i < nrounds; ++i) {
+            coid::taskmaster::signal_handle signal = tm.create_signal();
+            std::atomic<uint64> triggered(0);
+
+            std::thread producer([&]() {
+                coid::thread::wait(delay_ms);
+                triggered = coid::nsec_timer::current_time_ns();
+                tm.trigger_signal(signal);
+            });
+
+            const uint64 c0 = thread_cpu_time_ns();
+            const uint64 t0 = coid::nsec_timer::current_time_ns();
+
+            if (mode == 0)
+                tm.wait(signal);
+            else {
+                while (!triggered)
+                    coid::thread::wait(0);
+            }
+
+            const uint64 t1 = coid::nsec_timer::current_time_ns();
+            cpu += thread_cpu_time_ns() - c0;
+            wall += t1 - t0;
+
+            producer.join();
+
+            const uint64 d = t1 > triggered ? t1 - triggered : 0;
+            latency += d;
+            if (d > max_latency)
+                max_latency = d;
+        }
+
+        coidlog_info("bench_job_wait", (mode == 0 ? "taskmaster::wait" : "yield loop")
+            << ": avg wake latency " << (latency / nrounds / 1000) << "us, max " << (max_latency / 1000)
+            << "us, cpu burn " << (wall ? cpu * 100 / wall : 0) << "%");
+    }
+
+    tm.terminate(true);
+}
@@ -3,9 +3,16 @@
 #include "../radix.h"
 #include "../trait.h"
 #include "../hash/slothash.h"
+#include "../hash/flathashmap.h"
+#include "../hash/hashmap.h"
+#include "../hash/concurrent_hashkeyset.h"
+#include "../alloc/memtrack.h"
 #include "../function.h"
+#include "../binstream/binstreambuf.h"
 #include "intergen/ifc/client.h"
 
+#include <thread>
+
 namespace coid {
 void std_test();
 void metastream_test();
@@ -19,6 +26,7 @@ int main_atomic(int argc, char * argv[]);
 void regex_test();
 void test_malloc();
 void test_job_queue();
+void bench_job_wait();
 
 void float_test()
 {
@@ -254,13 +262,334 @@ void test_slotalloc_virtual()
 #endif
 }
 
+void test_dynarray_virtual_release()
+{
+    const uints n = 1 << 18;
+    dynarray<uint> data;
+    data.reserve_virtual(n, reserve_flags::hugepages, n / 4);
+    DASSERT(data.reserved_virtual() >= n * sizeof(uint));
+
+    data.add(n);
+    for (uint i = 0; i < n; ++i)
+        data[i] = i;
+
+    uints resident = data.resident_virtual();
+    data.resize(1000);
+    data.release_virtual();
+
+    DASSERT(data.resident_virtual() < resident && data[999] == 999);
+
+    //released pages are committed again on growth
+    data.add(n - 1000);
+    data[n - 1] = 1;
+}
+
+void test_slotalloc_concurrent()
+{
+#ifdef COID_CONSTEXPR_IF
+    static constexpr int NTHREADS = 4;
+    static constexpr int NITEMS = 10000;
+
+    slotalloc_versioning_concurrent<uints, uint> data(NTHREADS * NITEMS, coid::reserve_mode::virtual_space);
+
+    auto worker = [&](uints tid) {
+        versionid ids[NITEMS];
+        for (int i = 0; i < NITEMS; ++i) {
+            uints id;
+            *data.add(&id) = tid;
+            data.value<0>(id) = uint(i);
+            ids[i] = data.get_item_versionid(id);
+        }
+        for (int i = 0; i < NITEMS; i += 2)
+            data.del_item(ids[i]);
+        for (int i = 0; i < NITEMS; ++i) {
+            if (i & 1)
+                DASSERT(data.is_valid_id(ids[i]) && *data.get_item(ids[i]) == tid && data.value<0>(ids[i].id) == uint(i));
+            else
+                DASSERT(!data.is_valid_id(ids[i]));
+        }
+    };
+
+    std::thread threads[NTHREADS];
+    for (int i = 0; i < NTHREADS; ++i)
+        threads[i] = std::thread(worker, uints(i));
+    for (std::thread& t : threads)
+        t.join();
+
+    DASSERT(data.count() == NTHREADS * NITEMS / 2);
+#endif
+}
+
+void test_slotalloc_delta()
+{
+#ifdef COID_CONSTEXPR_IF
+    slotalloc_base<charstr, slotalloc_mode::tracking | slotalloc_mode::versioning, uint> src;
+    slotalloc_versioning<charstr, uint> dst;
+    binstreambuf buf;
+
+    for (uint i = 0; i < 100; ++i) {
+        uints id;
+        *src.add(&id) = "item";
+        src.value<0>(id) = i;
+    }
+
+    uint frame = src.advance_frame();
+    src.write_delta_since(buf, 0);
+    dst.read_delta(buf);
+    DASSERT(dst.count() == 100);
+
+    for (uint i = 0; i < 100; i += 3)
+        src.del_item(i);
+    *src.get_mutable_item(1) = "modified";
+    src.value<0>(1) = 1000;
+
+    buf.reset_all();
+    uints nslots = src.write_delta_since(buf, frame);
+    dst.read_delta(buf);
+
+    DASSERT(nslots == 35);
+    DASSERT(dst.count() == src.count());
+    DASSERT(*dst.get_item(1) == "modified" && dst.value<0>(1) == 1000);
+    DASSERT(dst.get_item_versionid(2) == src.get_item_versionid(2));
+    DASSERT(!dst.is_valid_id(3));
+#endif
+}
+
+void test_slotalloc_compact()
+{
+    slotalloc<charstr, uint> data;
+
+    for (uint i = 0; i < 1000; ++i) {
+        uints id;
+        *data.add(&id) = "item";
+        data.value<0>(id) = i;
+    }
+    for (uint i = 0; i < 1000; ++i) {
+        if (i % 10)
+            data.del_item(i);
+    }
+
+    uint nmoves = 0;
+    while (!data.compact(16, [&](uints oldid, uints newid) {
+        DASSERT(oldid > newid && data.value<0>(newid) == oldid);
+        ++nmoves;
+    }));
+
+    DASSERT(nmoves == 90);
+    DASSERT(data.count() == 100 && data.allocated_count() == 100);
+
+    //deletions between the slices below the already compacted prefix
+    for (uint i = 0; i < 1000; ++i)
+        data.add();
+    for (uint i = 0; i < 1100; i += 2)
+        data.del(i);
+
+    for (uint pass = 0; !data.compact(16, [](uints oldid, uints newid) {}); ++pass) {
+        if (pass == 4)
+            data.del(11);
+    }
+
+    DASSERT(data.count() == 549 && data.allocated_count() == 549);
+
+    //versionids of moved items must not resolve to new items created in the trimmed slots
+    slotalloc_versioning<uint> vdata;
+    versionid vids[8];
+
+    for (uint i = 0; i < 8; ++i) {
+        uint* p = vdata.add();
+        *p = i;
+        vids[i] = vdata.get_item_versionid(p);
+    }
+    for (uint i = 0; i < 4; ++i)
+        vdata.del_item(vids[i]);
+
+    vdata.compact(UMAXS, [](uints oldid, uints newid) {});
+
+    for (uint i = 0; i < 4; ++i)
+        *vdata.add() = 100 + i;
+
+    for (uint i = 0; i < 8; ++i)
+        DASSERT(!vdata.is_valid_id(vids[i]));
+}
+
+void test_flat_hash_map()
+{
+    flat_hash_map<charstr, uint> map;
+
+    for (uint i = 0; i < 1000; ++i) {
+        charstr key = "key";
+        key << i;
+        map.insert_key_value(key, i);
+    }
+    DASSERT(map.size() == 1000 && !map.insert_key_value("key5", 0));
+
+    for (uint i = 0; i < 1000; i += 2) {
+        charstr key = "key";
+        key << i;
+        DASSERT(map.erase(key) == 1);
+    }
+
+    DASSERT(map.size() == 500 && !map.find_value("key10") && *map.find_value("key11") == 11);
+
+    uint n = 0;
+    for (const auto& p : map) {
+        DASSERT(p.second & 1);
+        ++n;
+    }
+    DASSERT(n == 500);
+}
+
+void test_concurrent_hash_keyset()
+{
+    struct item {
+        uint key, val;
+        operator uint() const { return key; }
+    };
+
+    concurrent_hash_keyset<item, _Select_Copy<item, uint>> set;
+
+    std::thread th[4];
+    for (uint t = 0; t < 4; ++t) {
+        th[t] = std::thread([&set, t]() {
+            for (uint i = 0; i < 10000; ++i) {
+                uint k = i * 4 + t;
+                set.insert_value(item{ k, k });
+                set.find_value(k, [k](const item& v) { DASSERT(v.val == k); });
+                if (i & 1)
+                    set.erase(k - 4);
+            }
+        });
+    }
+    for (std::thread& t : th)
+        t.join();
+
+    DASSERT(set.size() == 20000);
+
+    uint n = 0;
+    set.for_each([&n](const item& v) { DASSERT((v.key / 4) & 1); ++n; });
+    DASSERT(n == 20000);
+
+    //values moved out in erase_if predicate
+    struct named {
+        charstr name;
+        uint val;
+        operator token() const { return name; }
+    };
+
+    concurrent_hash_keyset<named, _Select_Copy<named, token>> names;
+    for (uint i = 0; i < 100; ++i) {
+        named v;
+        v.name << "name" << i;
+        v.val = i;
+        names.insert_value(std::move(v));
+    }
+
+    dynarray<named> out;
+    size_t ne = names.erase_if([&out](named& v) {
+        if (v.val & 1)
+            return false;
+        *out.add() = std::move(v);
+        return true;
+    });
+    DASSERT(ne == 50 && out.size() == 50 && names.size() == 50);
+    DASSERT(!names.contains("name0"_T) && names.contains("name1"_T));
+
+    //keys with hashes above 32 bits
+    struct wide {
+        uint64 key;
+        operator uint64() const { return key; }
+    };
+
+    concurrent_hash_keyset<wide, _Select_Copy<wide, uint64>> wides;
+    for (uint64 i = 1; i <= 1000; ++i)
+        wides.insert_value(wide{ (i << 32) | (i * 7) });
+
+    DASSERT(wides.size() == 1000);
+    for (uint64 i = 1; i <= 1000; ++i) {
+        const uint64 k = (i << 32) | (i * 7);
+        DASSERT(wides.contains(k));
+        DASSERT(wides.update_value(k, [](wide&) {}));
+    }
+}
+
+template <int N>
+struct memtrack_tag {};
+
+template <int... I>
+static void memtrack_tags(std::integer_sequence<int, I...>)
+{
+    const std::type_info* types[] = { &typeid(memtrack_tag<I>)... };
+    for (const std::type_info* ti : types) {
+        memtrack_alloc(ti, 8);
+        memtrack_free(ti, 8);
+    }
+}
+
+void test_memtrack_reentrant()
+{
+    //growing the tracking table frees its old buckets through memtrack while the shard is locked
+    bool en = memtrack_enable(true);
+    uint n = memtrack_count();
+
+    memtrack_tags(std::make_integer_sequence<int, 4096>());
+
+    DASSERT(memtrack_count() >= n + 4096);
+    memtrack_enable(en);
+}
+
+void test_hashtable_incremental_rehash()
+{
+    hash_map<uint, uint> map;
+    map.set_incremental_rehash(1);
+
+    uint n = 0;
+    while (!map.rehashing() || n < 1000) {
+        map.insert_key_value(n, n);
+        ++n;
+    }
+
+    //lookups, iteration and erase while the old buckets are still being migrated
+    for (uint i = 0; i < n; ++i)
+        DASSERT(*map.find_value(i) == i);
+
+    uint k = 0;
+    auto it = map.begin();
+    while (it != map.end()) {
+        ++k;
+        if (it->first & 1)
+            map.erase(it);
+        else
+            ++it;
+    }
+    DASSERT(k == n && map.size() == (n + 1) / 2);
+    DASSERT(map.rehashing());
+
+    while (map.rehash_step(16));
+
+    for (uint i = 0; i < n; ++i)
+        DASSERT((map.find_value(i) != 0) == !(i & 1));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 int main( int argc, char* argv[] )
 {
+    if (argc > 1 && token(argv[1]) == "--bench-wait"_T) {
+        bench_job_wait();
+        return 0;
+    }
+
     singleton_test();
 
     test_malloc();
     test_slotalloc_virtual();
+    test_dynarray_virtual_release();
+    test_slotalloc_concurrent();
+    test_slotalloc_delta();
+    test_slotalloc_compact();
+    test_flat_hash_map();
+    test_concurrent_hash_keyset();
+    test_memtrack_reentrant();
+    test_hashtable_incremental_rehash();
 
     fntest(0);
 
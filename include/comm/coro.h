@@ -0,0 +1,664 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2020
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_CORO__HEADER_FILE__
+#define __COID_COMM_CORO__HEADER_FILE__
+
+#include "taskmaster.h"
+
+#if defined(__cpp_impl_coroutine) && (__cplusplus >= 202002L || _MSVC_LANG >= 202002L)
+#define COID_HAS_COROUTINES
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+
+COID_NAMESPACE_BEGIN
+
+/**
+    C++20 coroutines scheduled on taskmaster workers.
+
+    A coroutine returning coid::task<T> can co_await a taskmaster signal, another task or a group
+    of tasks. Suspended coroutines don't block any thread, they are pushed back to the taskmaster
+    once whatever they wait for is done, and are resumed by a worker.
+
+        coid::task<mesh*> load_mesh(const char* path)
+        {
+            coid::taskmaster::signal_handle read;
+            tm.push(coid::taskmaster::EPriority::LOW, &read, [&](){ read_file(path, data); });
+            co_await read;                          //suspends until the file task finishes
+            co_return build_mesh(data);
+        }
+
+        coid::task<> load_tile(tile& t)
+        {
+            coid::task<mesh*> a = load_mesh(t.path_a), b = load_mesh(t.path_b);
+            co_await coid::when_all(a, b);          //runs both in parallel
+            t.set(a.get(), b.get());
+        }
+
+        coid::taskmaster::signal_handle done;
+        coid::spawn(tm, coid::taskmaster::EPriority::LOW, &done, load_tile(t));
+
+    Tasks are lazy, a task starts when it's awaited or spawned. An awaited task runs on the
+    worker of the awaiting coroutine and inherits its taskmaster and priority.
+
+    Coroutine frames are allocated from per-thread pools, so suspending and resuming doesn't
+    allocate; the resumption is queued as a regular taskmaster task.
+**/
+template <class T = void>
+class task;
+
+namespace coro {
+
+///Per-thread pools of coroutine frames, by power of 2 size classes
+struct frame_pool
+{
+    enum {
+        MIN_SHIFT = 6,                  //< smallest class 64B
+        NCLASSES = 7,                   //< largest class 4kB, bigger frames go to the global heap
+        MAX_CACHED = 256,               //< max frames cached per class and thread
+    };
+
+    struct alignas(16) header {
+        uint32 sclass;
+    };
+
+    struct free_frame {
+        free_frame* next;
+    };
+
+    struct cache
+    {
+        free_frame* list[NCLASSES] = {};
+        uint count[NCLASSES] = {};
+
+        ~cache() {
+            for (uint i = 0; i < NCLASSES; ++i) {
+                while (free_frame* f = list[i]) {
+                    list[i] = f->next;
+                    ::operator delete(f);
+                }
+            }
+        }
+    };
+
+    static cache& local() {
+        static thread_local cache _cache;
+        return _cache;
+    }
+
+    static uint size_class(size_t size) {
+        uint sc = 0;
+        while ((size_t(1) << (sc + MIN_SHIFT)) < size)
+            ++sc;
+        return sc;
+    }
+
+    static void* alloc(size_t size)
+    {
+        size += sizeof(header);
+        const uint sc = size_class(size);
+
+        header* h;
+        if (sc >= NCLASSES)
+            h = static_cast<header*>(::operator new(size));
+        else {
+            cache& c = local();
+            free_frame* f = c.list[sc];
+            if (f) {
+                c.list[sc] = f->next;
+                --c.count[sc];
+            }
+            else
+                f = static_cast<free_frame*>(::operator new(size_t(1) << (sc + MIN_SHIFT)));
+            h = reinterpret_cast<header*>(f);
+        }
+
+        h->sclass = sc;
+        return h + 1;
+    }
+
+    ///Return frame to the pool of current thread
+    static void free(void* p)
+    {
+        header* h = static_cast<header*>(p) - 1;
+        const uint sc = h->sclass;
+
+        if (sc < NCLASSES) {
+            cache& c = local();
+            if (c.count[sc] < MAX_CACHED) {
+                free_frame* f = reinterpret_cast<free_frame*>(h);
+                f->next = c.list[sc];
+                c.list[sc] = f;
+                ++c.count[sc];
+                return;
+            }
+        }
+
+        ::operator delete(h);
+    }
+};
+
+///Counter of running child tasks, the last one to finish resumes the parent
+struct join_state
+{
+    std::atomic_int pending;
+    std::coroutine_handle<> parent;
+    taskmaster* tm;
+    taskmaster::EPriority prio;
+};
+
+///Common part of promises of taskmaster coroutines
+struct promise_base
+{
+    taskmaster* tm = 0;
+    taskmaster::EPriority prio = taskmaster::EPriority::NORMAL;
+    std::coroutine_handle<> continuation; //< awaiting coroutine, resumed when this one finishes
+    join_state* join = 0;               //< group of when_all, instead of continuation
+    std::exception_ptr error;
+
+    static void* operator new(size_t size) { return frame_pool::alloc(size); }
+    static void operator delete(void* p) { frame_pool::free(p); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct final_awaiter
+    {
+        bool await_ready() const noexcept { return false; }
+
+        template <class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+        {
+            promise_base& p = h.promise();
+            if (p.join) {
+                //resumed in place by the last child
+                if (p.join->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    return p.join->parent;
+                return std::noop_coroutine();
+            }
+            return p.continuation ? p.continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    final_awaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { error = std::current_exception(); }
+
+    void rethrow() const {
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+template <class T>
+struct promise : promise_base
+{
+    std::optional<T> value;
+
+    template <class U>
+    void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+
+    T& result() {
+        rethrow();
+        return *value;
+    }
+};
+
+template <>
+struct promise<void> : promise_base
+{
+    void return_void() {}
+
+    void result() { rethrow(); }
+};
+
+///Queue coroutine to be resumed by a worker
+inline void schedule(taskmaster* tm, taskmaster::EPriority prio, std::coroutine_handle<> h)
+{
+    DASSERT(tm);
+    tm->push(prio, 0, [h]() { h.resume(); });
+}
+
+///Fire and forget coroutine, the frame is released when it finishes
+struct detached
+{
+    struct promise_type : promise_base
+    {
+        detached get_return_object() {
+            return detached{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_never final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    ///Queue the coroutine on given taskmaster
+    void start(taskmaster* tm, taskmaster::EPriority prio) {
+        handle.promise().tm = tm;
+        handle.promise().prio = prio;
+        schedule(tm, prio, handle);
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+///Awaiter resuming the coroutine after a taskmaster signal gets signaled
+struct signal_awaiter
+{
+    taskmaster::signal_handle signal;
+
+    bool await_ready() const noexcept { return !signal.is_valid(); }
+
+    template <class P>
+    bool await_suspend(std::coroutine_handle<P> h)
+    {
+        promise_base& p = h.promise();
+        if (p.tm->is_signaled(signal))
+            return false;
+
+        p.tm->then(signal, p.prio, 0, [h]() { h.resume(); });
+        return true;
+    }
+
+    void await_resume() const noexcept {}
+};
+
+///Coroutine handle with its promise
+struct child
+{
+    promise_base* promise;
+    std::coroutine_handle<> handle;
+
+    template <class P>
+    static child of(std::coroutine_handle<P> h) {
+        return h ? child{&h.promise(), h} : child{0, 0};
+    }
+};
+
+///Start tasks on workers, the parent is resumed by the last one finished
+template <class Child>
+bool start_all(join_state& join, const Child& child_at, uints count)
+{
+    //the extra count is for the starting thread, so that the parent can't be resumed before all are queued
+    join.pending.store(int(count + 1), std::memory_order_relaxed);
+
+    taskmaster* tm = join.tm;
+    const taskmaster::EPriority prio = join.prio;
+    join_state* pjoin = &join;
+
+    for (uints i = 0; i < count; ++i) {
+        const child c = child_at(i);
+        if (!c.handle || c.handle.done()) {
+            pjoin->pending.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        c.promise->tm = tm;
+        c.promise->prio = prio;
+        c.promise->join = pjoin;
+        schedule(tm, prio, c.handle);
+    }
+
+    return pjoin->pending.fetch_sub(1, std::memory_order_acq_rel) != 1;
+}
+
+template <class T>
+struct when_all_range
+{
+    task<T>* tasks;
+    uints count;
+    join_state join;
+
+    bool await_ready() const noexcept { return count == 0; }
+
+    template <class P>
+    bool await_suspend(std::coroutine_handle<P> parent)
+    {
+        join.parent = parent;
+        join.tm = parent.promise().tm;
+        join.prio = parent.promise().prio;
+
+        task<T>* first = tasks;
+        return start_all(join, [first](uints i) { return child::of(first[i].handle()); }, count);
+    }
+
+    void await_resume() const noexcept {}
+};
+
+template <uints N>
+struct when_all_array
+{
+    child children[N];
+    join_state join;
+
+    bool await_ready() const noexcept { return false; }
+
+    template <class P>
+    bool await_suspend(std::coroutine_handle<P> parent)
+    {
+        join.parent = parent;
+        join.tm = parent.promise().tm;
+        join.prio = parent.promise().prio;
+
+        //copy of the handles, the awaiter can be gone once the last child is queued
+        child local[N];
+        for (uints i = 0; i < N; ++i)
+            local[i] = children[i];
+
+        return start_all(join, [&local](uints i) { return local[i]; }, N);
+    }
+
+    void await_resume() const noexcept {}
+};
+
+///Shared state of when_any, released by the last of the parent and children
+struct any_state
+{
+    std::atomic_int refs;
+    std::atomic_int winner;
+    std::atomic_int arrive;             //< winner and the starting thread, the second one resumes the parent
+    std::coroutine_handle<> parent;
+    taskmaster* tm;
+    taskmaster::EPriority prio;
+
+    static any_state* create(uints count) {
+        any_state* s = new(frame_pool::alloc(sizeof(any_state))) any_state;
+        s->refs.store(int(count + 1), std::memory_order_relaxed);
+        s->winner.store(-1, std::memory_order_relaxed);
+        s->arrive.store(2, std::memory_order_relaxed);
+        return s;
+    }
+
+    void release() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->~any_state();
+            frame_pool::free(this);
+        }
+    }
+
+    void finished(int index)
+    {
+        int expected = -1;
+        if (winner.compare_exchange_strong(expected, index, std::memory_order_acq_rel)
+            && arrive.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            schedule(tm, prio, parent);
+        release();
+    }
+
+    //@return true if the parent should stay suspended
+    bool started() {
+        return arrive.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+};
+
+template <class T>
+detached run_any(task<T> t, any_state* state, int index)
+{
+    try {
+        co_await t;
+    }
+    catch (...) {}
+
+    state->finished(index);
+}
+
+template <class T>
+detached run_spawned(task<T> t, taskmaster* tm, taskmaster::signal_handle done)
+{
+    try {
+        co_await t;
+    }
+    catch (...) {
+        coidlog_error("taskmaster", "unhandled exception in coroutine");
+    }
+
+    tm->trigger_signal(done);
+}
+
+template <class ...Ts>
+struct when_any_tuple
+{
+    std::tuple<task<Ts>...> tasks;
+    any_state* state = 0;
+
+    bool await_ready() const noexcept { return sizeof...(Ts) == 0; }
+
+    template <class P>
+    bool await_suspend(std::coroutine_handle<P> parent)
+    {
+        any_state* s = state = any_state::create(sizeof...(Ts));
+        s->parent = parent;
+        s->tm = parent.promise().tm;
+        s->prio = parent.promise().prio;
+
+        start(s, std::index_sequence_for<Ts...>());
+        return s->started();
+    }
+
+    //@return index of the task that finished first
+    int await_resume() const noexcept {
+        if (!state)
+            return -1;
+        const int index = state->winner.load(std::memory_order_acquire);
+        state->release();
+        return index;
+    }
+
+private:
+
+    template <size_t ...I>
+    void start(any_state* s, std::index_sequence<I...>) {
+        (run_any(std::move(std::get<I>(tasks)), s, int(I)).start(s->tm, s->prio), ...);
+    }
+};
+
+template <class T>
+struct when_any_range
+{
+    dynarray<task<T>> tasks;
+    any_state* state = 0;
+
+    explicit when_any_range(dynarray<task<T>>&& src) {
+        tasks.takeover(src);
+    }
+
+    bool await_ready() const noexcept { return tasks.size() == 0; }
+
+    template <class P>
+    bool await_suspend(std::coroutine_handle<P> parent)
+    {
+        const uints n = tasks.size();
+        any_state* s = state = any_state::create(n);
+        s->parent = parent;
+        s->tm = parent.promise().tm;
+        s->prio = parent.promise().prio;
+
+        task<T>* first = tasks.ptr();
+        for (uints i = 0; i < n; ++i)
+            run_any(std::move(first[i]), s, int(i)).start(s->tm, s->prio);
+
+        return s->started();
+    }
+
+    int await_resume() const noexcept {
+        if (!state)
+            return -1;
+        const int index = state->winner.load(std::memory_order_acquire);
+        state->release();
+        return index;
+    }
+};
+
+} // namespace coro
+
+////////////////////////////////////////////////////////////////////////////////
+///Lazily started coroutine with result of type T, scheduled on taskmaster workers
+template <class T>
+class task
+{
+public:
+
+    struct promise_type : coro::promise<T>
+    {
+        task get_return_object() {
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    task() = default;
+    task(task&& other) noexcept : _handle(other._handle) { other._handle = 0; }
+
+    task& operator = (task&& other) noexcept {
+        if (this != &other) {
+            if (_handle)
+                _handle.destroy();
+            _handle = other._handle;
+            other._handle = 0;
+        }
+        return *this;
+    }
+
+    ~task() {
+        if (_handle)
+            _handle.destroy();
+    }
+
+    //@return true if the task finished (or is empty)
+    bool is_ready() const { return !_handle || _handle.done(); }
+
+    ///Result of a finished task, rethrows exception escaped from the coroutine
+    decltype(auto) get() {
+        DASSERT(_handle && _handle.done());
+        return _handle.promise().result();
+    }
+
+    handle_t handle() const { return _handle; }
+
+    template <bool MOVE>
+    struct awaiter
+    {
+        handle_t h;
+
+        bool await_ready() const noexcept { return !h || h.done(); }
+
+        ///Start the task on current worker, it will resume the awaiting coroutine when done
+        template <class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> parent) noexcept
+        {
+            coro::promise_base& p = h.promise();
+            p.tm = parent.promise().tm;
+            p.prio = parent.promise().prio;
+            p.continuation = parent;
+            return h;
+        }
+
+        decltype(auto) await_resume() {
+            if constexpr (MOVE && !std::is_void_v<T>)
+                return T(std::move(h.promise().result()));
+            else
+                return h.promise().result();
+        }
+    };
+
+    awaiter<false> operator co_await() & noexcept { return {_handle}; }
+    awaiter<true> operator co_await() && noexcept { return {_handle}; }
+
+private:
+
+    explicit task(handle_t h) : _handle(h) {}
+
+    handle_t _handle;
+};
+
+///Suspend until the signal gets signaled
+inline coro::signal_awaiter operator co_await(taskmaster::signal_handle signal) noexcept {
+    return {signal};
+}
+
+///Run tasks in parallel on taskmaster workers, resume when all of them finish
+/// Results are kept in the tasks, use task::get() to retrieve them
+template <class T, class ...Ts>
+coro::when_all_array<1 + sizeof...(Ts)> when_all(task<T>& first, task<Ts>& ...rest) {
+    return {{coro::child::of(first.handle()), coro::child::of(rest.handle())...}, {}};
+}
+
+template <class T>
+coro::when_all_range<T> when_all(task<T>* tasks, uints count) {
+    return {tasks, count, {}};
+}
+
+template <class T>
+coro::when_all_range<T> when_all(dynarray<task<T>>& tasks) {
+    return {tasks.ptr(), tasks.size(), {}};
+}
+
+///Run tasks in parallel on taskmaster workers, resume when the first one finishes
+/// The tasks are taken over, the remaining ones keep running and are released when they finish
+//@return index of the first finished task
+template <class ...Ts>
+coro::when_any_tuple<Ts...> when_any(task<Ts>&& ...tasks) {
+    return {std::tuple<task<Ts>...>(std::move(tasks)...)};
+}
+
+template <class T>
+coro::when_any_range<T> when_any(dynarray<task<T>>&& tasks) {
+    return coro::when_any_range<T>(std::move(tasks));
+}
+
+///Run a coroutine task on taskmaster workers
+//@param priority priority of the coroutine and the tasks it awaits
+//@param signal signal to trigger when the coroutine finishes, same as in taskmaster::push
+template <class T>
+void spawn(taskmaster& tm, taskmaster::EPriority priority, taskmaster::signal_handle* signal, task<T> t)
+{
+    const taskmaster::signal_handle done = tm.create_signal();
+    if (signal)
+        tm.then(done, priority, signal, []() {});
+
+    coro::run_spawned(std::move(t), &tm, done).start(&tm, priority);
+}
+
+COID_NAMESPACE_END
+
+#endif //COID_HAS_COROUTINES
+
+#endif //__COID_COMM_CORO__HEADER_FILE__
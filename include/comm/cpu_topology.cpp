@@ -0,0 +1,236 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2020
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef SYSTYPE_WIN
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <stdio.h>
+#endif
+
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+const cpu_topology& cpu_topology::get()
+{
+    static cpu_topology topo = []() {
+        cpu_topology t;
+        t.detect();
+        return t;
+    }();
+
+    return topo;
+}
+
+#ifndef SYSTYPE_WIN
+
+////////////////////////////////////////////////////////////////////////////////
+static bool read_sys_uint(const char* path, uint& value)
+{
+    FILE* f = ::fopen(path, "r");
+    if (!f)
+        return false;
+
+    bool rv = ::fscanf(f, "%u", &value) == 1;
+    ::fclose(f);
+    return rv;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Read cpu list in "0-3,8,10-11" format
+static bool read_sys_cpulist(const char* path, cpuset& set)
+{
+    FILE* f = ::fopen(path, "r");
+    if (!f)
+        return false;
+
+    uint first, last;
+    int n;
+    while ((n = ::fscanf(f, "%u-%u", &first, &last)) >= 1) {
+        if (n == 1)
+            last = first;
+        for (uint i = first; i <= last; ++i)
+            set.set(i);
+
+        if (::fgetc(f) != ',')
+            break;
+    }
+
+    ::fclose(f);
+    return true;
+}
+
+#endif //!SYSTYPE_WIN
+
+////////////////////////////////////////////////////////////////////////////////
+void cpu_topology::detect()
+{
+    cpus.reset();
+    ncores = npackages = nnodes = 0;
+
+    cpuset avail;
+    if (!thread::get_affinity(avail) || avail.is_empty()) {
+        uint n = std::thread::hardware_concurrency();
+        for (uint i = 0; i < (n ? n : 1); ++i)
+            avail.set(i);
+    }
+
+    //raw os ids of core, package and node per logical cpu
+    struct raw {
+        uint id, core, package, node;
+    };
+    dynarray<raw> list;
+
+    avail.for_each([&](uint cpu) {
+        raw* r = list.add();
+        r->id = cpu;
+        r->core = cpu;
+        r->package = 0;
+        r->node = 0;
+    });
+
+#ifdef SYSTYPE_WIN
+    DWORD len = 0;
+    GetLogicalProcessorInformationEx(RelationAll, 0, &len);
+
+    dynarray<uint8> buf;
+    buf.alloc(len);
+
+    if (len && GetLogicalProcessorInformationEx(RelationAll, (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)buf.ptr(), &len))
+    {
+        uint ncore = 0, npkg = 0;
+
+        for (DWORD offs = 0; offs < len; ) {
+            const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* info = (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)(buf.ptr() + offs);
+            offs += info->Size;
+
+            auto assign = [&](const GROUP_AFFINITY& ga, uint raw::* field, uint value) {
+                list.for_each([&](raw& r) {
+                    if (r.id / 64 == ga.Group && (ga.Mask & ((KAFFINITY)1 << (r.id % 64))))
+                        r.*field = value;
+                });
+            };
+
+            if (info->Relationship == RelationProcessorCore) {
+                for (WORD g = 0; g < info->Processor.GroupCount; ++g)
+                    assign(info->Processor.GroupMask[g], &raw::core, ncore);
+                ++ncore;
+            }
+            else if (info->Relationship == RelationProcessorPackage) {
+                for (WORD g = 0; g < info->Processor.GroupCount; ++g)
+                    assign(info->Processor.GroupMask[g], &raw::package, npkg);
+                ++npkg;
+            }
+            else if (info->Relationship == RelationNumaNode) {
+                assign(info->NumaNode.GroupMask, &raw::node, info->NumaNode.NodeNumber);
+            }
+        }
+    }
+#else
+    char path[128];
+
+    list.for_each([&](raw& r) {
+        ::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/core_id", r.id);
+        read_sys_uint(path, r.core);
+        ::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", r.id);
+        read_sys_uint(path, r.package);
+    });
+
+    //node ids may be sparse
+    uint nfound = 0;
+    for (uint node = 0; node < cpuset::MAX_CPUS && nfound < list.size(); ++node) {
+        cpuset set;
+        ::snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+        if (!read_sys_cpulist(path, set))
+            continue;
+
+        list.for_each([&](raw& r) {
+            if (set.test(r.id)) {
+                r.node = node;
+                ++nfound;
+            }
+        });
+    }
+#endif
+
+    //map os ids to dense indices
+    auto remap = [&](uint raw::* field) {
+        dynarray<uint> ids;
+        list.for_each([&](const raw& r) {
+            if (!ids.contains(r.*field))
+                ids.push(r.*field);
+        });
+        std::sort(ids.ptr(), ids.ptre());
+
+        list.for_each([&](raw& r) {
+            r.*field = uint(std::lower_bound(ids.ptr(), ids.ptre(), r.*field) - ids.ptr());
+        });
+        return uint(ids.size());
+    };
+
+    npackages = remap(&raw::package);
+    nnodes = remap(&raw::node);
+
+    //core ids are unique only within a package
+    list.for_each([&](raw& r) {
+        r.core = r.package * cpuset::MAX_CPUS + r.core;
+    });
+    ncores = remap(&raw::core);
+
+    std::sort(list.ptr(), list.ptre(), [](const raw& a, const raw& b) {
+        if (a.node != b.node) return a.node < b.node;
+        if (a.package != b.package) return a.package < b.package;
+        if (a.core != b.core) return a.core < b.core;
+        return a.id < b.id;
+    });
+
+    cpus.alloc(list.size());
+    for (uints i = 0; i < list.size(); ++i) {
+        const raw& r = list[i];
+        logical_cpu& c = cpus[i];
+        c.id = r.id;
+        c.core = r.core;
+        c.package = r.package;
+        c.node = r.node;
+        c.smt = i > 0 && list[i - 1].core == r.core ? cpus[i - 1].smt + 1 : 0;
+    }
+}
+
+COID_NAMESPACE_END
@@ -0,0 +1,93 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2020
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_CPU_TOPOLOGY__HEADER_FILE__
+#define __COID_COMM_CPU_TOPOLOGY__HEADER_FILE__
+
+#include "namespace.h"
+#include "commtypes.h"
+#include "dynarray.h"
+#include "pthreadx.h"
+
+COID_NAMESPACE_BEGIN
+
+/**
+    Logical processor layout of the machine: SMT siblings, physical cores, packages and NUMA nodes.
+
+    Only processors the process is allowed to run on are listed. When the topology cannot be
+    read (missing sysfs etc.), each logical cpu is reported as a separate core on node 0.
+**/
+struct cpu_topology
+{
+    struct logical_cpu
+    {
+        uint id;                        //< os logical processor index
+        uint core;                      //< index of physical core (0..ncores-1)
+        uint package;                   //< index of package/socket (0..npackages-1)
+        uint node;                      //< index of NUMA node (0..nnodes-1)
+        uint smt;                       //< index of the hw thread within its core
+    };
+
+    dynarray<logical_cpu> cpus;         //< sorted by node, package, core, smt
+
+    uint ncores = 0;
+    uint npackages = 0;
+    uint nnodes = 0;
+
+
+    //@return topology of the current machine, detected on the first call
+    static const cpu_topology& get();
+
+    ///Detect topology of the current machine
+    void detect();
+
+    //@return set of cpus on given NUMA node
+    cpuset node_cpus(uint node) const {
+        cpuset set;
+        cpus.for_each([&](const logical_cpu& c) {
+            if (c.node == node)
+                set.set(c.id);
+        });
+        return set;
+    }
+
+    //@return logical cpu descriptor by os index, or nullptr if not available
+    const logical_cpu* find(uint id) const {
+        return cpus.find_if([id](const logical_cpu& c) { return c.id == id; });
+    }
+};
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_CPU_TOPOLOGY__HEADER_FILE__
@@ -55,6 +55,14 @@ COID_NAMESPACE_BEGIN
 #define xstat64 stat64
 #endif
 
+#ifndef SYSTYPE_WIN
+#include <unistd.h>
+#include <sys/stat.h>
+#define _rmdir rmdir
+#define _access access
+#define _chmod chmod
+#endif
+
 
 const char* directory::no_trail_sep(zstring& name)
 {
@@ -46,6 +46,9 @@
 #include <errno.h>
 #include <utime.h>
 #include <dlfcn.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
 
 #define xstat64 stat64
 
@@ -109,6 +112,16 @@ bool directory::is_entry_directory() const
     return S_ISDIR(_st.st_mode);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool directory::is_entry_subdirectory() const
+{
+    if(!is_entry_directory()) return false;
+
+    static token up = "..";
+    token name = get_last_file_name_token();
+    return name != '.' && name != up;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool directory::is_entry_regular() const
 {
@@ -244,6 +257,17 @@ charstr directory::get_home_dir()
     return "~/";
 }
 
+////////////////////////////////////////////////////////////////////////////////
+charstr directory::get_tmp_dir()
+{
+    const char* tmp = getenv("TMPDIR");
+
+    charstr buf = tmp && *tmp ? tmp : "/tmp";
+    if (buf.last_char() != '/')
+        buf.append('/');
+    return buf;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 opcd directory::truncate( zstring fname, uint64 size )
 {
@@ -77,6 +77,18 @@ enum class reserve_mode
     virtual_space,              //< reserve virtual address space for use for the whole lifetime, allocated dynamically
 };
 
+///Options for virtual space reservations
+enum class reserve_flags
+{
+    none = 0,
+    hugepages = MSPACE_VIRTUAL_HUGEPAGES,   //< transparent huge pages hint (Linux madvise), ignored on Windows
+    hugetlb = MSPACE_VIRTUAL_HUGETLB,       //< explicit huge pages (Linux MAP_HUGETLB), falls back to normal pages
+};
+
+inline constexpr reserve_flags operator | (reserve_flags a, reserve_flags b) {
+    return reserve_flags(int(a) | int(b));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //Fw
 template<class T, class COUNT, class A> class dynarray;
@@ -592,7 +604,7 @@ public:
         if (nitems == n)  return _ptr;
         if (nitems < n) {
             if coid_constexpr_if (!std::is_trivially_destructible<T>::value)
-                for (uints i = n - 1; i > nitems; --i)  _ptr[i].~T();
+                for (uints i = n; i > nitems; )  _ptr[--i].~T();
             _set_count(nitems);
             return _ptr;
         }
@@ -623,8 +635,8 @@ public:
 
         if (nitems == n)  return _ptr;
         if (nitems < n) {
-            for (uints i = n - 1; i > nitems; --i)
-                _ptr[i].~T();
+            for (uints i = n; i > nitems; )
+                _ptr[--i].~T();
             _set_count(nitems);
             return _ptr;
         }
@@ -1132,17 +1144,35 @@ public:
 
     ///Reserve \a nitems of elements
     /** @param nitems number of items to reserve
+        @param flags reservation options
+        @param nprefault number of leading items to commit and prefault right away
         @return pointer to the first item of array */
-    T* reserve_virtual(uints nitems)
+    T* reserve_virtual(uints nitems, reserve_flags flags = reserve_flags::none, uints nprefault = 0)
     {
         discard();
 
-        _ptr = A::template reserve<T>(nitems);
+        _ptr = A::template reserve<T>(nitems, 0, int(flags));
         _set_count(0);
 
+        if (nprefault)
+            prefault(nprefault);
+
         return _ptr;
     }
 
+    ///Commit and prefault memory for the first \a nitems of a virtual reservation
+    //@return number of items prefaulted, 0 if the array wasn't allocated by reserve_virtual
+    uints prefault(uints nitems) {
+        return A::prefault(_ptr, nitems * sizeof(T)) / sizeof(T);
+    }
+
+    ///Return the pages of a virtual reservation past the current item count to the system
+    //@note the address space stays reserved, released pages are zeroed when committed again
+    //@return number of bytes released
+    uints release_virtual() {
+        return A::release(_ptr, _count() * sizeof(T));
+    }
+
 
     ///Reserve \a nitems of elements
     /** @param nitems number of items to reserve
@@ -1707,6 +1737,9 @@ public:
     //@return reserved virtual size, if the memory was allocaded by reserve_virtual, otherwise 0
     uints reserved_virtual() const { return A::reserved_size(_ptr); }
 
+    //@return number of bytes backed by physical memory, if the memory was allocated by reserve_virtual, otherwise 0
+    uints resident_virtual() const { return A::resident_size(_ptr); }
+
 
     typedef T*                          iterator;
     typedef const T*                    const_iterator;
@@ -1734,6 +1767,11 @@ private:
         if (nalloc < oldsize + oldsize / 2)
             nalloc = oldsize + oldsize / 2;
 
+        //virtual reservation can't grow past the reserved space
+        uints vs = A::reserved_size(_ptr);
+        if (vs && nalloc > newsize && nalloc * sizeof(T) > vs)
+            nalloc = newsize > vs / sizeof(T) ? newsize : vs / sizeof(T);
+
         _ptr = A::template realloc<T>(_ptr, nalloc, m);
         _set_count(newsize);
 
@@ -0,0 +1,417 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2021
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_CONCURRENT_HASHKEYSET__HEADER_FILE__
+#define __COID_COMM_CONCURRENT_HASHKEYSET__HEADER_FILE__
+
+
+#include "../namespace.h"
+#include "../atomic/futex.h"
+#include "hashkeyset.h"
+
+#include <atomic>
+#include <thread>
+
+COID_NAMESPACE_BEGIN
+
+namespace concurrent_hash_detail {
+
+////////////////////////////////////////////////////////////////////////////////
+///Reader-writer spin lock guarding a single shard
+/// readers only increment a counter, a writer sets the write bit first to block new readers
+/// and then waits for the current ones to drain
+class shard_lock
+{
+    static constexpr int32 WRITER = 0x40000000;
+
+    std::atomic<int32> _state = {0};
+
+    static void backoff(uint& spins)
+    {
+        if (++spins < 64)
+            atomic::cpu_pause();
+        else
+            std::this_thread::yield();
+    }
+
+public:
+
+    void lock_shared()
+    {
+        uint spins = 0;
+        int32 s = _state.load(std::memory_order_relaxed);
+        for (;;) {
+            if (!(s & WRITER) && _state.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+            backoff(spins);
+            s = _state.load(std::memory_order_relaxed);
+        }
+    }
+
+    void unlock_shared()
+    {
+        _state.fetch_sub(1, std::memory_order_release);
+    }
+
+    void lock()
+    {
+        uint spins = 0;
+        int32 s = _state.load(std::memory_order_relaxed);
+        for (;;) {
+            if (!(s & WRITER) && _state.compare_exchange_weak(s, s | WRITER, std::memory_order_acquire, std::memory_order_relaxed))
+                break;
+            backoff(spins);
+            s = _state.load(std::memory_order_relaxed);
+        }
+
+        //wait for readers to leave
+        spins = 0;
+        while (_state.load(std::memory_order_acquire) != WRITER)
+            backoff(spins);
+    }
+
+    void unlock()
+    {
+        _state.store(0, std::memory_order_release);
+    }
+};
+
+///Scoped shared lock
+struct read_guard {
+    shard_lock& _lock;
+    read_guard(shard_lock& l) : _lock(l) { l.lock_shared(); }
+    ~read_guard() { _lock.unlock_shared(); }
+};
+
+///Scoped exclusive lock
+struct write_guard {
+    shard_lock& _lock;
+    write_guard(shard_lock& l) : _lock(l) { l.lock(); }
+    ~write_guard() { _lock.unlock(); }
+};
+
+} //namespace concurrent_hash_detail
+
+
+////////////////////////////////////////////////////////////////////////////////
+/**
+@class concurrent_hash_keyset
+Hash keyset that can be accessed from multiple threads, split into independently locked shards.
+Lookups take a shared lock on a single shard, so readers don't block each other and writers only
+block accesses to keys that fall into the same shard.
+
+Values are accessed through callbacks invoked while the shard is locked, since a pointer to the value
+could become dangling once the lock is released.
+@note callbacks must not access the same container, the shard locks are not recursive
+@param VAL value type stored in hash table
+@param EXTRACTKEY key extractor from value type, EXTRACTKEY::ret_type is the type extracted
+@param HASHFUNC hash function, HASHFUNC::key_type should be the type used for lookup
+@param EQFUNC equality functor, comparing EXTRACTKEY::ret_type extracted from value with HASHFUNC::key_type lookup key
+@param NSHARDS number of shards, a power of 2
+**/
+template <
+    class VAL,
+    class EXTRACTKEY,
+    class HASHFUNC = hasher<typename type_base<typename EXTRACTKEY::ret_type>::type>,
+    class EQFUNC = equal_to<typename type_base<typename EXTRACTKEY::ret_type>::type, typename HASHFUNC::key_type>,
+    uint NSHARDS = 16
+>
+class concurrent_hash_keyset
+{
+    static_assert((NSHARDS & (NSHARDS - 1)) == 0, "NSHARDS must be a power of 2");
+
+    typedef hash_keyset<VAL, EXTRACTKEY, HASHFUNC, EQFUNC> table_t;
+    typedef concurrent_hash_detail::read_guard read_guard;
+    typedef concurrent_hash_detail::write_guard write_guard;
+
+public:
+
+    typedef typename table_t::key_type              key_type;
+    typedef VAL                                     value_type;
+    typedef EXTRACTKEY                              extractor;
+    typedef HASHFUNC                                hasherfn;
+    typedef EQFUNC                                  key_equal;
+
+    typedef size_t                                  size_type;
+
+    ///Insert value if it's got an unique key
+    //@return false if a value with the same key already exists
+    bool insert_value(value_type&& val)
+    {
+        shard& s = get_shard(_GETKEYFUNC(val));
+        write_guard g(s.lock);
+        return s.table.insert_value(std::forward<value_type>(val)) != 0;
+    }
+
+    ///Insert value if it's got an unique key
+    //@return false if a value with the same key already exists
+    bool insert_value(const value_type& val)
+    {
+        shard& s = get_shard(_GETKEYFUNC(val));
+        write_guard g(s.lock);
+        return s.table.insert_value(val) != 0;
+    }
+
+    ///Insert new value or override the existing one under the same key
+    void insert_or_replace_value(value_type&& val)
+    {
+        shard& s = get_shard(_GETKEYFUNC(val));
+        write_guard g(s.lock);
+        s.table.insert_or_replace_value(std::forward<value_type>(val));
+    }
+
+    ///Insert new value or override the existing one under the same key
+    void insert_or_replace_value(const value_type& val)
+    {
+        shard& s = get_shard(_GETKEYFUNC(val));
+        write_guard g(s.lock);
+        s.table.insert_or_replace_value(val);
+    }
+
+    ///Create a default-constructed entry under given key and let the caller initialize it
+    //@param fn callback receiving the new value, fn(VAL&), invoked under the shard lock
+    //@note the value object should be initialized so that it would return the same key as the one passed in here
+    //@return false if the key already exists
+    template <class Fn>
+    bool insert_value_slot(const key_type& key, Fn fn)
+    {
+        shard& s = get_shard(key);
+        write_guard g(s.lock);
+
+        VAL* v = s.table.insert_value_slot(key);
+        if (v)
+            fn(*v);
+        return v != 0;
+    }
+
+    ///Find or create a default-constructed entry under given key
+    //@param fn callback receiving the value and whether it was just created, fn(VAL&, bool isnew), invoked under the shard lock
+    //@note a new value object should be initialized so that it would return the same key as the one passed in here
+    //@return true if the value was created
+    template <class Fn>
+    bool find_or_insert_value_slot(const key_type& key, Fn fn)
+    {
+        shard& s = get_shard(key);
+        write_guard g(s.lock);
+
+        bool isnew;
+        VAL* v = s.table.find_or_insert_value_slot(key, &isnew);
+        fn(*v, isnew);
+        return isnew;
+    }
+
+    ///Find value object corresponding to given key
+    //@param fn callback receiving the value, fn(const VAL&), invoked under a shared shard lock
+    //@return true if found
+    template <class Fn>
+    bool find_value(const key_type& key, Fn fn) const
+    {
+        uint64 h = _HASHFUNC(key);
+        const shard& s = _shards[shard_index(h)];
+        read_guard g(s.lock);
+
+        const VAL* v = s.table.find_value_hash(h, key);
+        if (v)
+            fn(*v);
+        return v != 0;
+    }
+
+    ///Find value and copy it out
+    //@return true if found
+    bool find_value(const key_type& key, VAL& dst) const
+    {
+        return find_value(key, [&](const VAL& v) { dst = v; });
+    }
+
+    ///Modify an existing value
+    //@param fn callback receiving the value, fn(VAL&), invoked under an exclusive shard lock
+    //@note the callback must not change the key of the value
+    //@return true if found
+    template <class Fn>
+    bool update_value(const key_type& key, Fn fn)
+    {
+        uint64 h = _HASHFUNC(key);
+        shard& s = _shards[shard_index(h)];
+        write_guard g(s.lock);
+
+        VAL* v = const_cast<VAL*>(s.table.find_value_hash(h, key));
+        if (v)
+            fn(*v);
+        return v != 0;
+    }
+
+    bool contains(const key_type& key) const
+    {
+        return find_value(key, [](const VAL&) {});
+    }
+
+    ///Erase value under given key
+    //@param dst optional pointer to receive the erased value
+    //@return true if found and erased
+    bool erase_value(const key_type& key, VAL* dst)
+    {
+        shard& s = get_shard(key);
+        write_guard g(s.lock);
+        return s.table.erase_value(key, dst);
+    }
+
+    //@return number of erased values
+    size_type erase(const key_type& key)
+    {
+        shard& s = get_shard(key);
+        write_guard g(s.lock);
+        return s.table.erase(key);
+    }
+
+    ///Invoke callback on all values, one shard at a time under a shared lock
+    //@param fn callback fn(const VAL&)
+    //@note values inserted or erased in other shards during the walk may or may not be visited
+    template <class Fn>
+    void for_each(Fn fn) const
+    {
+        for (const shard& s : _shards) {
+            read_guard g(s.lock);
+            for (const VAL& v : s.table)
+                fn(v);
+        }
+    }
+
+    ///Invoke callback on all values, one shard at a time under an exclusive lock
+    //@param fn callback fn(VAL&)
+    //@note the callback must not change keys of the values
+    template <class Fn>
+    void for_each_mutable(Fn fn)
+    {
+        for (shard& s : _shards) {
+            write_guard g(s.lock);
+            for (VAL& v : s.table)
+                fn(v);
+        }
+    }
+
+    ///Erase all values for which the predicate returns true
+    //@param fn predicate fn(VAL&) -> bool, invoked under an exclusive shard lock; the value may be moved out of
+    //@return number of erased values
+    template <class Fn>
+    size_type erase_if(Fn fn)
+    {
+        size_type n = 0;
+        for (shard& s : _shards) {
+            write_guard g(s.lock);
+
+            auto i = s.table.begin();
+            auto ie = s.table.end();
+            while (i != ie) {
+                VAL& v = *i;
+                ++i;
+
+                //key of a moved-from value is no longer valid, hash it before the predicate runs
+                uint64 hash = _HASHFUNC(_GETKEYFUNC(v));
+
+                if (fn(v)) {
+                    s.table.erase_value_slot_hash(&v, hash);
+                    ++n;
+                }
+            }
+        }
+        return n;
+    }
+
+    //@return total number of values, not synchronized across shards
+    size_type size() const
+    {
+        size_type n = 0;
+        for (const shard& s : _shards) {
+            read_guard g(s.lock);
+            n += s.table.size();
+        }
+        return n;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    void clear()
+    {
+        for (shard& s : _shards) {
+            write_guard g(s.lock);
+            s.table.clear();
+        }
+    }
+
+    static constexpr uint shard_count() { return NSHARDS; }
+
+
+    concurrent_hash_keyset()
+    {}
+
+    explicit concurrent_hash_keyset(const extractor& ex, const hasherfn& hf = hasherfn(), const key_equal& eql = key_equal())
+        : _HASHFUNC(hf), _GETKEYFUNC(ex)
+    {
+        for (shard& s : _shards) {
+            table_t t(ex, hf, eql);
+            swap(s.table, t);
+        }
+    }
+
+    concurrent_hash_keyset(const concurrent_hash_keyset&) = delete;
+    concurrent_hash_keyset& operator = (const concurrent_hash_keyset&) = delete;
+
+private:
+
+    ///Shard with its own lock, on a separate cache line
+    struct alignas(64) shard
+    {
+        mutable concurrent_hash_detail::shard_lock lock;
+        table_t table;
+    };
+
+    shard _shards[NSHARDS];
+
+    HASHFUNC _HASHFUNC;
+    EXTRACTKEY _GETKEYFUNC;
+
+    ///Shard from the middle bits of the mixed hash, buckets inside the shard tables use the top bits
+    static uint shard_index(uint64 hash)
+    {
+        return uint((11400714819323198485llu * (hash ^ (hash >> 32))) >> 24) & (NSHARDS - 1);
+    }
+
+    shard& get_shard(const key_type& key) {
+        return _shards[shard_index(_HASHFUNC(key))];
+    }
+};
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_CONCURRENT_HASHKEYSET__HEADER_FILE__
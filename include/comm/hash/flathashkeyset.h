@@ -0,0 +1,203 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2021
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_FLATHASHKEYSET__HEADER_FILE__
+#define __COID_COMM_FLATHASHKEYSET__HEADER_FILE__
+
+
+#include "../namespace.h"
+#include "flathashtable.h"
+#include "hashkeyset.h"
+
+COID_NAMESPACE_BEGIN
+
+
+////////////////////////////////////////////////////////////////////////////////
+/**
+@class flat_hash_keyset
+Open-addressing variant of hash_keyset, with values stored inline
+@param VAL value type stored in hash table
+@param EXTRACTKEY key extractor from value type, EXTRACTKEY::ret_type is the type extracted
+@param HASHFUNC hash function, HASHFUNC::key_type should be the type used for lookup
+@param EQFUNC equality functor, comparing EXTRACTKEY::ret_type extracted from value with HASHFUNC::key_type lookup key
+@note pointers to values are invalidated by insertions that grow the table
+**/
+template <
+    class VAL,
+    class EXTRACTKEY,
+    class HASHFUNC = hasher<typename type_base<typename EXTRACTKEY::ret_type>::type>,
+    class EQFUNC = equal_to<typename type_base<typename EXTRACTKEY::ret_type>::type, typename HASHFUNC::key_type>
+>
+class flat_hash_keyset
+    : public flat_hashtable<VAL, HASHFUNC, EQFUNC, EXTRACTKEY>
+{
+    typedef flat_hashtable<VAL, HASHFUNC, EQFUNC, EXTRACTKEY> _HT;
+
+public:
+
+    typedef typename _HT::LOOKUP                    key_type;
+    typedef VAL                                     value_type;
+    typedef EXTRACTKEY                              extractor;
+    typedef HASHFUNC                                hasherfn;
+    typedef EQFUNC                                  key_equal;
+
+    typedef size_t                                  size_type;
+    typedef ptrdiff_t                               difference_type;
+    typedef value_type* pointer;
+    typedef const value_type* const_pointer;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+
+    typedef typename _HT::iterator                  iterator;
+    typedef typename _HT::const_iterator            const_iterator;
+
+    std::pair<iterator, bool> insert(const value_type& val)
+    {
+        return this->insert_unique(val);
+    }
+
+    void insert(const value_type* f, const value_type* l)
+    {
+        this->insert_unique(f, l);
+    }
+
+    void insert(const_iterator f, const_iterator l)
+    {
+        this->insert_unique(f, l);
+    }
+
+    ///Insert value if it's got an unique key
+    //@return NULL if the value could not be inserted, or a constant pointer to the value
+    const VAL* insert_value(value_type&& val)
+    {
+        return this->slot_ptr(this->__insert_unique(std::forward<value_type>(val)));
+    }
+
+    ///Insert value if it's got an unique key
+    //@return NULL if the value could not be inserted, or a constant pointer to the value
+    const VAL* insert_value(const value_type& val)
+    {
+        return this->slot_ptr(this->__insert_unique(val));
+    }
+
+    ///Insert new value or override the existing one under the same key.
+    //@return constant pointer to the value
+    const VAL* insert_or_replace_value(value_type&& val)
+    {
+        return this->slot_ptr(this->__insert_unique__replace(std::forward<value_type>(val)));
+    }
+
+    ///Insert new value or override the existing one under the same key.
+    //@return constant pointer to the value
+    const VAL* insert_or_replace_value(const value_type& val)
+    {
+        return this->slot_ptr(this->__insert_unique__replace(val));
+    }
+
+    ///Create a default-constructed entry for value object that will be initialized by the caller afterwards
+    //@note the value object should be initialized so that it would return the same key as the one passed in here
+    //@param key the key under which the value object should be created
+    VAL* insert_value_slot(const key_type& key)
+    {
+        return this->template _insert_unique_slot<true>(key);
+    }
+
+    ///Create an uninitialized entry for value object that will be initialized by the caller afterwards
+    //@note the value object should be initialized so that it would return the same key as the one passed in here
+    //@param key the key under which the value object should be created
+    VAL* insert_value_slot_uninit(const key_type& key)
+    {
+        return this->template _insert_unique_slot<false>(key);
+    }
+
+    ///Find or create an empty entry for value object that will be initialized by the caller afterwards
+    //@note the value object should be initialized so that it would return the same key as the one passed in here
+    //@param key the key under which the value object should be created
+    VAL* find_or_insert_value_slot(const key_type& key, bool* isnew = 0)
+    {
+        return this->template _find_or_insert_slot<true>(key, isnew);
+    }
+
+    ///Find or create an uninitialized entry for value object that will be initialized by the caller afterwards
+    //@note the value object should be initialized so that it would return the same key as the one passed in here
+    //@param key the key under which the value object should be created
+    VAL* find_or_insert_value_slot_uninit(const key_type& key, bool* isnew = 0)
+    {
+        return this->template _find_or_insert_slot<false>(key, isnew);
+    }
+
+
+    ///Find value object corresponding to given key
+    const VAL* find_value(const key_type& k) const
+    {
+        return this->find_value_ptr(k);
+    }
+
+    ///Find value object corresponding to given key
+    const VAL* find_value(uint hash, const key_type& k) const
+    {
+        return this->find_value_ptr(hash, k);
+    }
+
+
+    flat_hash_keyset()
+        : _HT(0, hasherfn(), key_equal(), extractor()) {}
+
+    explicit flat_hash_keyset(size_type n)
+        : _HT(n, hasherfn(), key_equal(), extractor()) {}
+
+    explicit flat_hash_keyset(const extractor& ex, size_type n = 0)
+        : _HT(n, hasherfn(), key_equal(), ex) {}
+    flat_hash_keyset(const extractor& ex, const hasherfn& hf, size_type n = 0)
+        : _HT(n, hf, key_equal(), ex) {}
+    flat_hash_keyset(const extractor& ex, const hasherfn& hf, const key_equal& eql, size_type n = 0)
+        : _HT(n, hf, eql, ex) {}
+
+
+    flat_hash_keyset(const value_type* f, const value_type* l, size_type n = 0)
+        : _HT(n, hasherfn(), key_equal(), extractor())
+    {
+        this->insert_unique(f, l);
+    }
+    flat_hash_keyset(const value_type* f, const value_type* l,
+        const extractor& ex, size_type n = 0)
+        : _HT(n, hasherfn(), key_equal(), ex)
+    {
+        this->insert_unique(f, l);
+    }
+};
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_FLATHASHKEYSET__HEADER_FILE__
@@ -0,0 +1,889 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2021
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_FLATHASHTABLE__HEADER_FILE__
+#define __COID_COMM_FLATHASHTABLE__HEADER_FILE__
+
+
+#include "../namespace.h"
+#include "../dynarray.h"
+#include "../metastream/metastream.h"
+#include "../bitrange.h"
+
+#include "hashfunc.h"
+#include "hashtable.h"
+
+COID_NAMESPACE_BEGIN
+
+namespace flat_hash_detail {
+
+///Control byte values, full slots hold the 7 low bits of the hash (0..127)
+enum : int8 {
+    EMPTY = -128,
+    DELETED = -2,
+};
+
+///Number of control bytes probed at once
+static constexpr uints GROUP = 16;
+
+////////////////////////////////////////////////////////////////////////////////
+///Group of control bytes, match functions return a bit mask of matching slots
+struct group
+{
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    __m128i _ctrl;
+
+    explicit group(const int8* ctrl)
+        : _ctrl(_mm_loadu_si128((const __m128i*)ctrl))
+    {}
+
+    uint match(int8 h2) const {
+        return uint(_mm_movemask_epi8(_mm_cmpeq_epi8(_ctrl, _mm_set1_epi8(h2))));
+    }
+
+    uint match_empty() const {
+        return match(EMPTY);
+    }
+
+    ///Empty or deleted slots (both below -1)
+    uint match_free() const {
+        return uint(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), _ctrl)));
+    }
+
+    uint match_full() const {
+        return uint(_mm_movemask_epi8(_ctrl)) ^ 0xffffU;
+    }
+#else
+    const int8* _ctrl;
+
+    explicit group(const int8* ctrl)
+        : _ctrl(ctrl)
+    {}
+
+    uint match(int8 h2) const {
+        uint m = 0;
+        for (uint i = 0; i < GROUP; ++i)
+            m |= uint(_ctrl[i] == h2) << i;
+        return m;
+    }
+
+    uint match_empty() const {
+        return match(EMPTY);
+    }
+
+    uint match_free() const {
+        uint m = 0;
+        for (uint i = 0; i < GROUP; ++i)
+            m |= uint(_ctrl[i] < -1) << i;
+        return m;
+    }
+
+    uint match_full() const {
+        uint m = 0;
+        for (uint i = 0; i < GROUP; ++i)
+            m |= uint(_ctrl[i] >= 0) << i;
+        return m;
+    }
+#endif
+};
+
+} //namespace flat_hash_detail
+
+
+////////////////////////////////////////////////////////////////////////////////
+///Base class for open-addressing hash containers
+/// Values are stored inline in a flat array, a parallel array of control bytes holds 7 bits of
+/// the hash for each used slot, so that a lookup compares 16 slots at once and touches the
+/// values only for likely matches. Groups of 16 slots are probed quadratically.
+//@note pointers to values are invalidated when the table grows, unlike with the chained hashtable
+//@param VAL value type stored in the table
+//@param HASHFUNC hash functor, should define type of the key as key_type
+//@param EQFUNC equality functor
+//@param GETKEYFUNC key extractor from VAL
+template <class VAL, class HASHFUNC, class EQFUNC, class GETKEYFUNC>
+class flat_hashtable
+{
+public:
+
+    ///Type used for lookups is deduced from the hash template
+    typedef typename HASHFUNC::key_type         LOOKUP;
+
+private:
+
+    typedef flat_hashtable<VAL, HASHFUNC, EQFUNC, GETKEYFUNC>   _Self;
+    typedef flat_hash_detail::group                             group;
+
+    static constexpr uints GROUP = flat_hash_detail::GROUP;
+
+    static_assert(alignof(VAL) <= 16, "unsupported value alignment");
+
+    int8* _ctrl = 0;                    //< control bytes, one per slot
+    VAL* _slots = 0;                    //< inline values, follow the control bytes in the same allocation
+    uints _capacity = 0;                //< number of slots, power of 2 multiple of GROUP, or 0
+    uints _nelem = 0;
+    uints _growth_left = 0;             //< number of empty slots that can be used before a rehash
+
+protected:
+
+    HASHFUNC    _HASHFUNC;
+    EQFUNC      _EQFUNC;
+    GETKEYFUNC  _GETKEYFUNC;
+
+    ///Mix the user hash, low bits select the group, top 7 bits go into the control byte
+    static uint64 mix(uint64 hash) {
+        uint64 m = (hash ^ (hash >> 32)) * 11400714819323198485llu;
+        return m ^ (m >> 32);
+    }
+
+    static int8 h2(uint64 m) {
+        return int8(m >> 57);
+    }
+
+    uint64 mixed_hash(const LOOKUP& k) const {
+        return mix(uint64(_HASHFUNC(k)));
+    }
+
+public:
+
+    const HASHFUNC& hash_func() const { return _HASHFUNC; }
+    HASHFUNC& hash_func() { return _HASHFUNC; }
+
+    const EQFUNC& equal_func() const { return _EQFUNC; }
+    EQFUNC& equal_func() { return _EQFUNC; }
+
+
+    class Ptr
+    {
+        uints _i;
+        const _Self* _ht;
+
+    public:
+
+        typedef LOOKUP                  key_type;
+        typedef VAL                     value_type;
+        typedef HASHFUNC                hasher;
+        typedef EQFUNC                  key_equal;
+
+        typedef size_t                  size_type;
+        typedef ptrdiff_t               difference_type;
+        typedef VAL* pointer;
+        typedef const VAL* const_pointer;
+        typedef VAL& reference;
+        typedef const VAL& const_reference;
+
+        typedef std::forward_iterator_tag iterator_category;
+
+        uints _get_index() const { return _i; }
+        const _Self* _get_ht() const { return _ht; }
+
+        Ptr(uints i, const _Self& ht) : _i(i), _ht(&ht) {}
+        Ptr() : _i(UMAXS), _ht(0) {}
+
+        bool operator == (const Ptr& p) const { return _i == p._i; }
+        bool operator != (const Ptr& p) const { return _i != p._i; }
+
+        reference operator*() { return _ht->_slots[_i]; }
+        pointer operator ->() { return _ht->_slots + _i; }
+
+        Ptr& operator++()
+        {
+            _i = _ht->next_full(_i + 1);
+            return *this;
+        }
+
+        inline Ptr operator++(int)
+        {
+            Ptr tmp = *this;
+            ++* this;
+            return tmp;
+        }
+    };
+
+    class CPtr
+    {
+        uints _i;
+        const _Self* _ht;
+
+    public:
+
+        typedef LOOKUP                  key_type;
+        typedef VAL                     value_type;
+        typedef HASHFUNC                hasher;
+        typedef EQFUNC                  key_equal;
+
+        typedef size_t                  size_type;
+        typedef ptrdiff_t               difference_type;
+        typedef VAL* pointer;
+        typedef const VAL* const_pointer;
+        typedef VAL& reference;
+        typedef const VAL& const_reference;
+
+        typedef std::forward_iterator_tag iterator_category;
+
+        CPtr(uints i, const _Self& ht) : _i(i), _ht(&ht) {}
+        CPtr() : _i(UMAXS), _ht(0) {}
+
+        CPtr(const Ptr& p)
+        {
+            _i = p._get_index();
+            _ht = p._get_ht();
+        }
+
+        CPtr& operator = (const Ptr& p)
+        {
+            _i = p._get_index();
+            _ht = p._get_ht();
+            return *this;
+        }
+
+        bool operator == (const CPtr& p) const { return _i == p._i; }
+        bool operator != (const CPtr& p) const { return _i != p._i; }
+
+        const_reference operator*() const { return _ht->_slots[_i]; }
+        const_pointer operator ->() const { return _ht->_slots + _i; }
+
+        CPtr& operator++()
+        {
+            _i = _ht->next_full(_i + 1);
+            return *this;
+        }
+
+        inline CPtr operator++(int)
+        {
+            CPtr tmp = *this;
+            ++* this;
+            return tmp;
+        }
+    };
+
+    typedef Ptr                         iterator;
+    typedef CPtr                        const_iterator;
+
+    struct hashtable_binstream_container : public binstream_containerT<VAL>
+    {
+        typedef typename binstream_containerT<VAL>::fnc_stream    fnc_stream;
+
+        virtual const void* extract(uints n)
+        {
+            DASSERT(_begin != _end);
+            const VAL* p = &(*_begin);
+            ++_begin;
+            return p;
+        }
+
+        virtual void* insert(uints n)
+        {
+            //values are inserted when the container is destroyed, the key isn't known yet
+            return *_newval.add() = new VAL;
+        }
+
+        virtual bool is_continuous() const { return false; }
+
+        virtual uints count() const { return _ht.size(); }
+
+
+        hashtable_binstream_container(const _Self& ht)
+            : _ht((_Self&)ht)
+        {
+            _begin = _ht.begin();
+            _end = _ht.end();
+        }
+
+        hashtable_binstream_container(const _Self& ht, fnc_stream fout, fnc_stream fin)
+            : binstream_containerT<VAL>(fout, fin), _ht((_Self&)ht)
+        {
+            _begin = _ht.begin();
+            _end = _ht.end();
+        }
+
+        ~hashtable_binstream_container()
+        {
+            _ht.reserve(_ht.size() + _newval.size());
+
+            for (uints i = 0; i < _newval.size(); ++i) {
+                _ht.__insert_equal(std::move(*_newval[i]));
+                delete _newval[i];
+            }
+        }
+
+    protected:
+        _Self& _ht;
+        const_iterator _begin, _end;
+        dynarray<VAL*> _newval;
+    };
+
+protected:
+
+    ///Find slot with value matching the key
+    //@return slot index or UMAXS
+    uints find_slot(uint64 m, const LOOKUP& k) const
+    {
+        if (!_nelem)
+            return UMAXS;
+
+        const int8 tag = h2(m);
+        const uints gmask = _capacity / GROUP - 1;
+        uints g = uints(m) & gmask;
+
+        for (uints i = 1; ; ++i) {
+            group grp(_ctrl + g * GROUP);
+
+            uint match = grp.match(tag);
+            while (match) {
+                uints s = g * GROUP + lsb_bit_set(match);
+                if (_EQFUNC(_GETKEYFUNC(_slots[s]), k))
+                    return s;
+                match &= match - 1;
+            }
+
+            if (grp.match_empty())
+                return UMAXS;
+
+            g = (g + i) & gmask;
+        }
+    }
+
+    ///Find first empty or deleted slot on the probe sequence
+    uints find_free(uint64 m) const
+    {
+        const uints gmask = _capacity / GROUP - 1;
+        uints g = uints(m) & gmask;
+
+        for (uints i = 1; ; ++i) {
+            uint free = group(_ctrl + g * GROUP).match_free();
+            if (free)
+                return g * GROUP + lsb_bit_set(free);
+
+            g = (g + i) & gmask;
+        }
+    }
+
+    ///Claim a slot for a new value with given mixed hash, the value has to be constructed by the caller
+    uints prepare_insert(uint64 m)
+    {
+        uints s = _capacity ? find_free(m) : UMAXS;
+        if (s == UMAXS || (_growth_left == 0 && _ctrl[s] != flat_hash_detail::DELETED)) {
+            grow();
+            s = find_free(m);
+        }
+
+        if (_ctrl[s] == flat_hash_detail::EMPTY)
+            --_growth_left;
+
+        _ctrl[s] = h2(m);
+        ++_nelem;
+        return s;
+    }
+
+    ///Destroy value in slot and release the slot
+    void erase_slot(uints s)
+    {
+        DASSERT(s < _capacity && _ctrl[s] >= 0);
+
+        _slots[s].~VAL();
+        --_nelem;
+
+        //probing stops at groups with an empty slot, so the slot can be made empty too
+        if (group(_ctrl + (s & ~(GROUP - 1))).match_empty()) {
+            _ctrl[s] = flat_hash_detail::EMPTY;
+            ++_growth_left;
+        }
+        else
+            _ctrl[s] = flat_hash_detail::DELETED;
+    }
+
+    //@return slot index of given value pointer, or UMAXS if it's not a live value of this table
+    uints slot_index(const VAL* v) const
+    {
+        uints s = v - _slots;
+        return v >= _slots && s < _capacity && _ctrl[s] >= 0 ? s : UMAXS;
+    }
+
+    ///Next full slot at or after i
+    //@return slot index or UMAXS
+    uints next_full(uints i) const
+    {
+        while (i < _capacity) {
+            uints g = i & ~(GROUP - 1);
+            uint m = group(_ctrl + g).match_full() & (0xffffU << (i - g));
+            if (m)
+                return g + lsb_bit_set(m);
+            i = g + GROUP;
+        }
+        return UMAXS;
+    }
+
+public:
+
+    binstream& stream_out(binstream& bin) const
+    {
+        hashtable_binstream_container bc(*this);
+        bin.xwrite_array(bc);
+
+        return bin;
+    }
+
+    binstream& stream_in(binstream& bin)
+    {
+        hashtable_binstream_container bc(*this);
+        bin.xread_array(bc);
+
+        return bin;
+    }
+
+    metastream& stream_out(metastream& m) const
+    {
+        hashtable_binstream_container bc(*this);
+        m.write_container(bc);
+
+        return m;
+    }
+
+    metastream& stream_in(metastream& m)
+    {
+        hashtable_binstream_container bc(*this);
+        m.read_container(bc);
+
+        return m;
+    }
+
+
+    size_t size() const { return _nelem; }
+    size_t max_size() const { return size_t(-1); }
+    bool empty() const { return size() == 0; }
+
+    //@return number of slots
+    size_t bucket_count() const { return _capacity; }
+
+    friend void swap(_Self& a, _Self& b)
+    {
+        std::swap(a._HASHFUNC, b._HASHFUNC);
+        std::swap(a._EQFUNC, b._EQFUNC);
+        std::swap(a._GETKEYFUNC, b._GETKEYFUNC);
+        std::swap(a._ctrl, b._ctrl);
+        std::swap(a._slots, b._slots);
+        std::swap(a._capacity, b._capacity);
+        std::swap(a._nelem, b._nelem);
+        std::swap(a._growth_left, b._growth_left);
+    }
+
+    iterator begin() { return iterator(next_full(0), *this); }
+    iterator end() { return iterator(UMAXS, *this); }
+
+    const_iterator begin() const { return const_iterator(next_full(0), *this); }
+    const_iterator end() const { return const_iterator(UMAXS, *this); }
+
+
+    iterator find(const LOOKUP& k) {
+        return iterator(find_slot(mixed_hash(k), k), *this);
+    }
+
+    const_iterator find(const LOOKUP& k) const {
+        return const_iterator(find_slot(mixed_hash(k), k), *this);
+    }
+
+    size_t count(const LOOKUP& k) const {
+        return find_slot(mixed_hash(k), k) != UMAXS ? 1 : 0;
+    }
+
+    bool erase_value(const VAL& v) {
+        return __erase_value(_GETKEYFUNC(v), 0);
+    }
+
+    bool erase_value(const LOOKUP& k, VAL* dst) {
+        return __erase_value(k, dst);
+    }
+
+    bool erase_value_slot(const VAL* dst)
+    {
+        uints s = slot_index(dst);
+        if (s == UMAXS)
+            return false;
+
+        erase_slot(s);
+        return true;
+    }
+
+    ///Erase value provided external key (if key in value was already destroyed)
+    bool erase_value_slot(const VAL* dst, const LOOKUP& key) {
+        return erase_value_slot(dst);
+    }
+
+    size_t erase(const LOOKUP& k) {
+        return __erase_value(k, 0) ? 1 : 0;
+    }
+
+    void erase(iterator& it)
+    {
+        uints s = it._get_index();
+        ++it;
+        erase_slot(s);
+    }
+
+    ///Reserve space for given number of values without rehashing
+    //@return true if the table was rehashed
+    bool reserve(size_t n)
+    {
+        uints cap = GROUP;
+        while (cap - cap / 8 < n)
+            cap <<= 1;
+
+        if (cap <= _capacity)
+            return false;
+
+        rehash(cap);
+        return true;
+    }
+
+    //@return true if the underlying array was resized
+    bool resize(size_t n) {
+        return reserve(n);
+    }
+
+    void clear()
+    {
+        if (!_capacity)
+            return;
+
+        if coid_constexpr_if (!std::is_trivially_destructible<VAL>::value)
+            for (uints i = next_full(0); i != UMAXS; i = next_full(i + 1))
+                _slots[i].~VAL();
+
+        ::memset(_ctrl, flat_hash_detail::EMPTY, _capacity);
+        _nelem = 0;
+        _growth_left = _capacity - _capacity / 8;
+    }
+
+
+    std::pair<iterator, bool> insert_unique(const VAL& v)
+    {
+        uints s = __insert_unique(v);
+        if (s == UMAXS)
+            return std::pair<iterator, bool>(end(), false);
+        else
+            return std::pair<iterator, bool>(iterator(s, *this), true);
+    }
+
+    void insert_unique(const VAL* f, const VAL* l)
+    {
+        reserve(_nelem + (l - f));
+        for (; f != l; ++f)
+            __insert_unique(*f);
+    }
+
+    void insert_unique(const_iterator f, const_iterator l)
+    {
+        for (; f != l; ++f)
+            __insert_unique(*f);
+    }
+
+
+    flat_hashtable(uints n, const HASHFUNC& hf, const EQFUNC& eqf, const GETKEYFUNC& gkf)
+        : _HASHFUNC(hf)
+        , _EQFUNC(eqf)
+        , _GETKEYFUNC(gkf)
+    {
+        if (n)
+            reserve(n);
+    }
+
+    flat_hashtable(const flat_hashtable& ht)
+        : _HASHFUNC(ht._HASHFUNC)
+        , _EQFUNC(ht._EQFUNC)
+        , _GETKEYFUNC(ht._GETKEYFUNC)
+    {
+        copy_from(ht);
+    }
+
+    flat_hashtable(flat_hashtable&& ht)
+        : _HASHFUNC(ht._HASHFUNC)
+        , _EQFUNC(ht._EQFUNC)
+        , _GETKEYFUNC(ht._GETKEYFUNC)
+    {
+        swap(*this, ht);
+    }
+
+    _Self& operator = (const _Self& ht)
+    {
+        if (this != &ht) {
+            clear();
+            copy_from(ht);
+        }
+        return *this;
+    }
+
+    _Self& operator = (_Self&& ht)
+    {
+        if (this != &ht) {
+            clear();
+            swap(*this, ht);
+        }
+        return *this;
+    }
+
+    ~flat_hashtable()
+    {
+        clear();
+        ::dlfree(_ctrl);
+    }
+
+private:
+
+    void copy_from(const _Self& ht)
+    {
+        if (!ht._nelem)
+            return;
+
+        if (_capacity < ht._capacity) {
+            ::dlfree(_ctrl);
+            allocate(ht._capacity);
+        }
+
+        if (_capacity == ht._capacity) {
+            //same layout, copy slot by slot
+            ::memcpy(_ctrl, ht._ctrl, _capacity);
+            for (uints i = next_full(0); i != UMAXS; i = next_full(i + 1))
+                new(_slots + i) VAL(ht._slots[i]);
+
+            _nelem = ht._nelem;
+            _growth_left = ht._growth_left;
+        }
+        else {
+            for (uints i = ht.next_full(0); i != UMAXS; i = ht.next_full(i + 1))
+                __insert_equal(ht._slots[i]);
+        }
+    }
+
+    ///Allocate empty arrays for given number of slots
+    void allocate(uints cap)
+    {
+        DASSERT(cap >= GROUP && (cap & (cap - 1)) == 0);
+
+        _ctrl = (int8*)::dlmalloc(cap + cap * sizeof(VAL));
+        if (!_ctrl)
+            throw std::bad_alloc();
+
+        _slots = (VAL*)(_ctrl + cap);
+        ::memset(_ctrl, flat_hash_detail::EMPTY, cap);
+
+        _capacity = cap;
+        _nelem = 0;
+        _growth_left = cap - cap / 8;
+    }
+
+    ///Move all values into new arrays of given size, dropping the deleted slots
+    void rehash(uints cap)
+    {
+        int8* octrl = _ctrl;
+        VAL* oslots = _slots;
+        uints ocap = _capacity;
+        uints nelem = _nelem;
+
+        allocate(cap);
+
+        for (uints i = 0; i < ocap; ++i) {
+            if (octrl[i] < 0)
+                continue;
+
+            VAL& v = oslots[i];
+            uint64 m = mixed_hash(_GETKEYFUNC(v));
+            uints s = find_free(m);
+            _ctrl[s] = h2(m);
+            new(_slots + s) VAL(std::move(v));
+            v.~VAL();
+        }
+
+        _nelem = nelem;
+        _growth_left -= nelem;
+
+        ::dlfree(octrl);
+    }
+
+    ///Make room for a new value, either by purging the deleted slots or by doubling the capacity
+    void grow()
+    {
+        if (_capacity && _nelem <= (_capacity - _capacity / 8) / 2)
+            rehash(_capacity);
+        else
+            rehash(_capacity ? _capacity * 2 : GROUP);
+    }
+
+protected:
+
+    bool __erase_value(const LOOKUP& k, VAL* dst)
+    {
+        uints s = find_slot(mixed_hash(k), k);
+        if (s == UMAXS)
+            return false;
+
+        if (dst)
+            std::swap(*dst, _slots[s]);
+
+        erase_slot(s);
+        return true;
+    }
+
+    ///Create a default-constructed or uninitialized value slot for a key that's not in the table yet
+    //@return slot pointer or null if the key already exists
+    template <bool INIT>
+    VAL* _insert_unique_slot(const LOOKUP& k)
+    {
+        uint64 m = mixed_hash(k);
+        if (find_slot(m, k) != UMAXS)
+            return 0;
+
+        VAL* p = _slots + prepare_insert(m);
+        if coid_constexpr_if (INIT)
+            new(p) VAL;
+        return p;
+    }
+
+    template <bool INIT>
+    VAL* _find_or_insert_slot(const LOOKUP& k, bool* isnew)
+    {
+        uint64 m = mixed_hash(k);
+        uints s = find_slot(m, k);
+        bool isnew_ = s == UMAXS;
+
+        if (isnew_) {
+            s = prepare_insert(m);
+            if coid_constexpr_if (INIT)
+                new(_slots + s) VAL;
+        }
+
+        if (isnew) *isnew = isnew_;
+
+        return _slots + s;
+    }
+
+    //@return slot index of the inserted value or UMAXS if the key already exists
+    template <class V>
+    uints __insert_unique(V&& v)
+    {
+        typename GETKEYFUNC::ret_type k = _GETKEYFUNC(v);
+        uint64 m = mixed_hash(k);
+        if (find_slot(m, k) != UMAXS)
+            return UMAXS;
+
+        uints s = prepare_insert(m);
+        new(_slots + s) VAL(std::forward<V>(v));
+        return s;
+    }
+
+    //@return slot index of the inserted or replaced value
+    template <class V>
+    uints __insert_unique__replace(V&& v)
+    {
+        typename GETKEYFUNC::ret_type k = _GETKEYFUNC(v);
+        uint64 m = mixed_hash(k);
+        uints s = find_slot(m, k);
+        if (s != UMAXS) {
+            _slots[s] = std::forward<V>(v);
+            return s;
+        }
+
+        s = prepare_insert(m);
+        new(_slots + s) VAL(std::forward<V>(v));
+        return s;
+    }
+
+    ///Insert value without checking for an existing key
+    template <class V>
+    uints __insert_equal(V&& v)
+    {
+        uint64 m = mixed_hash(_GETKEYFUNC(v));
+        uints s = prepare_insert(m);
+        new(_slots + s) VAL(std::forward<V>(v));
+        return s;
+    }
+
+    VAL* slot_ptr(uints s) const {
+        return s != UMAXS ? _slots + s : 0;
+    }
+
+    VAL* find_value_ptr(const LOOKUP& k) const {
+        return slot_ptr(find_slot(mixed_hash(k), k));
+    }
+
+    VAL* find_value_ptr(uint64 hash, const LOOKUP& k) const {
+        return slot_ptr(find_slot(mix(hash), k));
+    }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+template <class VAL, class HASHFUNC, class EQFUNC, class GETKEYFUNC>
+inline binstream& operator << (binstream& bin, const flat_hashtable<VAL, HASHFUNC, EQFUNC, GETKEYFUNC>& a)
+{
+    return a.stream_out(bin);
+}
+
+template <class VAL, class HASHFUNC, class EQFUNC, class GETKEYFUNC>
+inline binstream& operator >> (binstream& bin, flat_hashtable<VAL, HASHFUNC, EQFUNC, GETKEYFUNC>& a)
+{
+    return a.stream_in(bin);
+}
+
+template <class VAL, class HASHFUNC, class EQFUNC, class GETKEYFUNC>
+inline metastream& operator || (metastream& m, flat_hashtable<VAL, HASHFUNC, EQFUNC, GETKEYFUNC>& a)
+{
+    typedef flat_hashtable<VAL, HASHFUNC, EQFUNC, GETKEYFUNC> _HT;
+
+    if (m.stream_reading()) {
+        a.clear();
+        return a.stream_in(m);
+    }
+    else if (m.stream_writing()) {
+        return a.stream_out(m);
+    }
+    else {
+        if (m.meta_decl_array(
+            typeid(a).name(),
+            -1,
+            sizeof(a),
+            false,
+            0,  //not a linear array
+            [](const void* a) -> uints { return static_cast<const _HT*>(a)->size(); },
+            0,
+            0
+        ))
+            m || *(VAL*)0;
+    }
+
+    return m;
+}
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_FLATHASHTABLE__HEADER_FILE__
@@ -235,6 +235,13 @@ public:
         return v ? &v->_val : 0;
     }
 
+    ///Find value object corresponding to given key, using full 64-bit hash of the key
+    const VAL* find_value_hash(uint64 hash, const key_type& k) const
+    {
+        const typename _HT::Node* v = _HT::find_node(hash, k);
+        return v ? &v->_val : 0;
+    }
+
 
     hash_keyset()
         : _HT(128, hasherfn(), key_equal(), extractor()) {}
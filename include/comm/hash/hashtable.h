@@ -142,6 +142,12 @@ private:
     uints _nelem;
     uint _shift = 64;
 
+    //incremental rehash state
+    dynarray<Node*> _old;               //< previous table, buckets from _migrated up still hold nodes
+    uint _oldshift = 64;
+    uints _migrated = 0;                //< number of old buckets already moved to _table
+    uints _rehash_step = 0;             //< old buckets migrated per insert, 0 for rehashing all at once
+
     typedef hashtable<VAL, HASHFUNC, EQFUNC, GETKEYFUNC, ALLOC>  _Self;
 
 protected:
@@ -165,10 +171,28 @@ protected:
 
     static uints bucket_from_hash(uint64 hash, uint shift) {
         //fibonacci hashing
-        hash ^= hash >> shift;
+        //@note the fold doesn't depend on shift, so that a bucket splits into a contiguous range of buckets in a larger table
+        hash ^= hash >> 32;
         return uints((11400714819323198485llu * hash) >> shift);
     }
 
+    //@return number of initialized buckets in _table, during incremental rehash only those of already migrated old buckets
+    uints valid_buckets() const {
+        return _old.size() ? _migrated << (_oldshift - _shift) : _table.size();
+    }
+
+    ///Chain holding nodes with given hash
+    //@note during incremental rehash the nodes stay in the old table until their bucket is migrated
+    Node** socket_from_hash(uint64 hash) const
+    {
+        if (_old.size()) {
+            uints h = bucket_from_hash(hash, _oldshift);
+            if (h >= _migrated)
+                return (Node**)&_old[h];
+        }
+        return (Node**)&_table[bucket_from_hash(hash, _shift)];
+    }
+
 public:
 
     const HASHFUNC& hash_func() const { return _HASHFUNC; }
@@ -375,8 +399,7 @@ protected:
     ///Find first node that matches the key, provided hash value is given
     Node* find_node(uint64 hash, const LOOKUP& k) const
     {
-        uints h = bucket_from_hash(hash, _shift);
-        Node* n = (Node*)_table[h];
+        Node* n = *socket_from_hash(hash);
         while (n)
         {
             if (_EQFUNC(_GETKEYFUNC(n->_val), k))
@@ -389,8 +412,7 @@ protected:
     ///Find first node that matches the key
     Node* find_node(const LOOKUP& k) const
     {
-        uints h = bucket(k, _shift);
-        Node* n = (Node*)_table[h];
+        Node* n = *socket_from_hash(_HASHFUNC(k));
         while (n)
         {
             if (_EQFUNC(_GETKEYFUNC(n->_val), k))
@@ -401,24 +423,23 @@ protected:
     }
 
     ///Find first node that matches the key
-    Node* find_node(const LOOKUP& k, uints& slot) const
+    Node** find_socket_ext(const dynarray<Node*>& a, uint shift, const LOOKUP& k) const
     {
-        slot = bucket(k, _shift);
-        Node* n = (Node*)_table[slot];
-        while (n)
+        uints h = bucket(k, shift);
+        Node** n = (Node**)&a[h];
+        while (*n)
         {
-            if (_EQFUNC(_GETKEYFUNC(n->_val), k))
+            if (_EQFUNC(_GETKEYFUNC((*n)->_val), k))
                 return n;
-            n = n->_next;
+            n = &(*n)->_next;
         }
-        return 0;
+        return n;
     }
 
     ///Find first node that matches the key
-    Node** find_socket_ext(const dynarray<Node*>& a, uint shift, const LOOKUP& k) const
+    Node** find_socket(const LOOKUP& k) const
     {
-        uints h = bucket(k, shift);
-        Node** n = (Node**)&a[h];
+        Node** n = socket_from_hash(_HASHFUNC(k));
         while (*n)
         {
             if (_EQFUNC(_GETKEYFUNC((*n)->_val), k))
@@ -428,16 +449,11 @@ protected:
         return n;
     }
 
-    ///Find first node that matches the key
-    Node** find_socket(const LOOKUP& k) const {
-        return find_socket_ext(_table, _shift, k);
-    }
-
     ///Find socket with given value
-    Node** find_socket_val(const VAL* val, uints socket = UMAXS) const
+    //@param head chain to search in, if null it's determined from the value key
+    Node** find_socket_val(const VAL* val, Node** head = 0) const
     {
-        uints h = socket != UMAXS ? socket : bucket(_GETKEYFUNC(*val), _shift);
-        Node** pn = (Node**)&_table[h];
+        Node** pn = head ? head : socket_from_hash(_HASHFUNC(_GETKEYFUNC(*val)));
         Node* n = *pn;
         while (n && &n->_val != val)
         {
@@ -472,9 +488,8 @@ protected:
     Node** get_socket(const Node* n) const
     {
         if (!n)  return 0;
-        uints h = bucket(_GETKEYFUNC(n->_val), _shift);
 
-        Node** pn = (Node**)&_table[h];
+        Node** pn = socket_from_hash(_HASHFUNC(_GETKEYFUNC(n->_val)));
         while (*pn)
         {
             if (*pn == n)
@@ -522,11 +537,22 @@ public:
 
 
     ///
+    //@note during incremental rehash the nodes in the current table are visited first, followed by the not yet migrated nodes of the old table
     Node* get_next(const Node* cn) const
     {
         if (!cn)  return 0;
 
-        uints h = bucket(_GETKEYFUNC(cn->_val), _shift);
+        uint64 hash = _HASHFUNC(_GETKEYFUNC(cn->_val));
+
+        if (_old.size()) {
+            uints h = bucket_from_hash(hash, _oldshift);
+            if (h >= _migrated) {
+                DASSERTX(_old[h] != 0, "probably mixed keys and different hash functions used");
+                return first_nonempty(_old, h + 1, _old.size());
+            }
+        }
+
+        uints h = bucket_from_hash(hash, _shift);
         DASSERTX(_table[h] != 0, "probably mixed keys and different hash functions used");
 
         return get_nonempty(++h);
@@ -534,13 +560,8 @@ public:
 
     Node* get_nonempty(uints slot) const
     {
-        uints n = _table.size();
-        for (; slot < n; ++slot)
-        {
-            if (_table[slot])
-                return (Node*)_table[slot];
-        }
-        return 0;
+        Node* n = first_nonempty(_table, slot, valid_buckets());
+        return n ? n : first_nonempty(_old, _migrated, _old.size());
     }
 
     size_t size() const { return _nelem; }
@@ -554,15 +575,16 @@ public:
         std::swap(a._GETKEYFUNC, b._GETKEYFUNC);
         std::swap(a._table, b._table);
         std::swap(a._nelem, b._nelem);
+        std::swap(a._shift, b._shift);
+        std::swap(a._old, b._old);
+        std::swap(a._oldshift, b._oldshift);
+        std::swap(a._migrated, b._migrated);
+        std::swap(a._rehash_step, b._rehash_step);
     }
 
     iterator begin()
     {
-        uints n = _table.size();
-        for (uints i = 0; i < n; ++i)
-            if (_table[i])
-                return iterator(_table[i], *this);
-        return end();
+        return iterator(get_nonempty(0), *this);
     }
 
     iterator end() {
@@ -571,11 +593,7 @@ public:
 
     const_iterator begin() const
     {
-        uints n = _table.size();
-        for (uints i = 0; i < n; ++i)
-            if (_table[i])
-                return const_iterator(_table[i], *this);
-        return end();
+        return const_iterator(get_nonempty(0), *this);
     }
 
     const_iterator end() const {
@@ -593,6 +611,9 @@ public:
 
     size_t elems_in_bucket(size_t k) const
     {
+        if (k >= valid_buckets())
+            return 0;
+
         Node* n = _table[k];
         size_t r = 0;
         for (; n != 0; n = n->_next)  ++r;
@@ -635,31 +656,31 @@ public:
 
     std::pair<iterator, iterator> equal_range(const LOOKUP& k)
     {
-        uints slot;
-        Node* f = find_node(k, slot);
+        Node* f = find_node(k);
         if (!f)
             return std::pair<iterator, iterator>(end(), end());
 
+        Node* p = f;
         Node* l = f->_next;
         while (l  &&  _EQFUNC(_GETKEYFUNC(l->_val), k))
-            l = l->_next;
+            l = (p = l)->_next;
 
-        if (!l)  l = get_nonempty(++slot);
+        if (!l)  l = get_next(p);
         return std::pair<iterator, iterator>(iterator(f, *this), iterator(l, *this));
     }
 
     std::pair<const_iterator, const_iterator> equal_range(const LOOKUP& k) const
     {
-        uints slot;
-        const Node* f = find_node(k, slot);
+        const Node* f = find_node(k);
         if (!f)
             return std::pair<const_iterator, const_iterator>(end(), end());
 
+        const Node* p = f;
         const Node* l = f->_next;
         while (l  &&  _EQFUNC(_GETKEYFUNC(l->_val), k))
-            l = l->_next;
+            l = (p = l)->_next;
 
-        if (!l)  l = get_nonempty(++slot);
+        if (!l)  l = get_next(p);
         return std::pair<const_iterator, const_iterator>(const_iterator(f, *this), const_iterator(l, *this));
     }
 
@@ -677,7 +698,12 @@ public:
 
     ///Erase value provided external key (if key in value was already destroyed)
     bool erase_value_slot(const VAL* dst, const LOOKUP& key) {
-        return this->__erase_value_slot(dst, bucket(key, _shift));
+        return this->__erase_value_slot(dst, socket_from_hash(_HASHFUNC(key)));
+    }
+
+    ///Erase value provided hash of its key computed before the key was destroyed
+    bool erase_value_slot_hash(const VAL* dst, uint64 hash) {
+        return this->__erase_value_slot(dst, socket_from_hash(hash));
     }
 
     size_t erase(const LOOKUP& k) {
@@ -714,59 +740,111 @@ public:
 
 
     //@return true if the underlying array was resized
+    //@note with incremental rehash enabled the nodes are migrated to the new table gradually on subsequent inserts
     bool resize(size_t bucketn)
     {
         uints ts = _table.size();
         if (bucketn > ts)
         {
+            //a previous migration has to be completed first
+            rehash_step(UMAXS);
+
             uint8 shift = int_high_pow2(bucketn);
             uints nb = uints(1) << shift;
 
             shift = 64 - shift;
 
+            //buckets are zeroed as the old ones get migrated
             dynarray<Node*> temp;
-            temp.need_newc(nb);
+            if (ts)
+                temp.need_new(nb);
+            else
+                temp.need_newc(nb);
             _ALLOC.reserve(nb);
 
-            for (uints i = 0; i < ts; ++i)
-            {
-                Node* n = _table[i];
-                while (n)
-                {
-                    //n->_next points to an old location, rebase
-                    Node* t = n->_next;
-                    Node** pn = find_socket_ext(temp, shift, _GETKEYFUNC(n->_val));
-
-                    n->_next = *pn;
-                    *pn = n;
-
-                    n = t;
-                }
-            }
+            std::swap(_old, _table);
+            std::swap(temp, _table);
 
+            _oldshift = _shift;
             _shift = shift;
+            _migrated = 0;
 
-            std::swap(temp, _table);
+            rehash_step(_rehash_step && _nelem ? _rehash_step : UMAXS);
             return true;
         }
 
         return false;
     }
 
-    void clear()
+    ///Set up incremental rehashing, spreading the cost of growing the table over subsequent inserts
+    //@param nbuckets number of old buckets to migrate per insert, 0 to rehash all at once (default)
+    //@note lookups don't migrate so that they can run concurrently, use rehash_step() to advance the migration explicitly
+    void set_incremental_rehash(uints nbuckets)
+    {
+        _rehash_step = nbuckets;
+        if (!nbuckets)
+            rehash_step(UMAXS);
+    }
+
+    //@return true if an incremental rehash is in progress
+    bool rehashing() const {
+        return _old.size() > 0;
+    }
+
+    ///Migrate up to given number of buckets from the old table during an incremental rehash
+    //@param nbuckets number of old buckets to migrate, UMAXS to complete the migration
+    //@return true if the migration is still in progress
+    bool rehash_step(uints nbuckets)
     {
-        for (uints i = 0; i < _table.size(); ++i)
+        uints ts = _old.size();
+        if (!ts)
+            return false;
+
+        uints end = nbuckets < ts - _migrated ? _migrated + nbuckets : ts;
+        uint split = _oldshift - _shift;
+
+        for (uints i = _migrated; i < end; ++i)
         {
-            Node* n = _table[i];
+            //old bucket maps to a contiguous range of new buckets
+            ::memset(_table.ptr() + (i << split), 0, sizeof(Node*) << split);
+
+            Node* n = _old[i];
             while (n)
             {
+                //n->_next points to an old location, rebase
                 Node* t = n->_next;
-                _ALLOC.free(n);
+                Node** pn = find_socket_ext(_table, _shift, _GETKEYFUNC(n->_val));
+
+                n->_next = *pn;
+                *pn = n;
+
                 n = t;
             }
-            _table[i] = 0;
+            _old[i] = 0;
+        }
+
+        if (end < ts) {
+            _migrated = end;
+            return true;
         }
 
+        _old.discard();
+        _migrated = 0;
+        return false;
+    }
+
+    void clear()
+    {
+        uints nvalid = valid_buckets();
+        free_buckets(_table, nvalid);
+        free_buckets(_old, _old.size());
+
+        if (nvalid < _table.size())
+            ::memset(_table.ptr() + nvalid, 0, (_table.size() - nvalid) * sizeof(Node*));
+
+        _old.discard();
+        _migrated = 0;
+
         _nelem = 0;
         //_table.need_newc(64);
     }
@@ -860,15 +938,33 @@ public:
 private:
     void copy_from(const _Self& ht)
     {
-        uints n = ht._table.size();
-        _table.reset();
-        resize(n);
-        _ALLOC.reserve(n);
+        _ALLOC.reserve(ht._table.size());
+
+        copy_buckets(_table, ht._table, ht.valid_buckets());
+        copy_buckets(_old, ht._old, ht._old.size());
+
+        _shift = ht._shift;
+        _oldshift = ht._oldshift;
+        _migrated = ht._migrated;
+        _rehash_step = ht._rehash_step;
+        _nelem = ht._nelem;
+    }
 
-        for (uints h = 0; h < n; ++h)
+    //@param nvalid number of initialized buckets in src
+    void copy_buckets(dynarray<Node*>& dst, const dynarray<Node*>& src, uints nvalid)
+    {
+        uints n = src.size();
+        if (!n) {
+            dst.discard();
+            return;
+        }
+
+        dst.need_newc(n);
+
+        for (uints h = 0; h < nvalid; ++h)
         {
-            Node** pn = &_table[h];
-            const Node* cn = ht._table[h];
+            Node** pn = &dst[h];
+            const Node* cn = src[h];
             while (cn)
             {
                 Node* n = new(_ALLOC.alloc_uninit()) Node(*cn);
@@ -878,8 +974,31 @@ private:
             }
             *pn = 0;
         }
+    }
 
-        _nelem = ht._nelem;
+    void free_buckets(dynarray<Node*>& a, uints nvalid)
+    {
+        for (uints i = 0; i < nvalid; ++i)
+        {
+            Node* n = a[i];
+            while (n)
+            {
+                Node* t = n->_next;
+                _ALLOC.free(n);
+                n = t;
+            }
+            a[i] = 0;
+        }
+    }
+
+    static Node* first_nonempty(const dynarray<Node*>& a, uints slot, uints n)
+    {
+        for (; slot < n; ++slot)
+        {
+            if (a[slot])
+                return (Node*)a[slot];
+        }
+        return 0;
     }
 
 protected:
@@ -996,9 +1115,9 @@ protected:
         return true;
     }
 
-    bool __erase_value_slot(const VAL* val, uints socket = UMAXS)
+    bool __erase_value_slot(const VAL* val, Node** head = 0)
     {
-        Node** pn = find_socket_val(val, socket);
+        Node** pn = find_socket_val(val, head);
         if (!pn)
             return false;
 
@@ -1135,9 +1254,12 @@ protected:
 
 private:
 
-    //@return true if the underlying array was resized
+    ///Advance a pending incremental rehash and grow the table if needed before inserting
+    //@return true if nodes were moved, sockets obtained before have to be looked up again
     bool adjust(uint n) {
-        return resize(_nelem + n);
+        bool moved = _old.size() > 0;
+        rehash_step(_rehash_step);
+        return resize(_nelem + n) || moved;
     }
 
 };
@@ -1,8 +1,7 @@
 
 #include "interface.h"
 #include "commexception.h"
-#include "hash/hashkeyset.h"
-#include "sync/mutex.h"
+#include "hash/concurrent_hashkeyset.h"
 #include "dir.h"
 #include "intergen/ifc.h"
 
@@ -40,8 +39,7 @@ struct entry
 ////////////////////////////////////////////////////////////////////////////////
 class interface_register_impl
 {
-    hash_keyset<entry, _Select_Copy<entry, token> > _hash;
-    comm_mutex _mx;
+    concurrent_hash_keyset<entry, _Select_Copy<entry, token> > _hash;
 
     charstr _root_path;
     interface_register::fn_log_t _fn_log;
@@ -58,8 +56,7 @@ public:
     static interface_register_impl& get();
 
     interface_register_impl()
-        : _mx(500, false)
-        , _fn_log(0)
+        : _fn_log(0)
         , _fn_acc(0)
         , _fn_getlog(0)
     {}
@@ -119,30 +116,23 @@ public:
 
         token handle = modulename.cut_right_back(':', token::cut_trait_remove_sep_default_empty());
 
-        GUARDTHIS(_mx);
-
         if (!creator_ptr) {
             return _hash.erase_value(key, 0);
         }
-        else {
-            entry* en = _hash.insert_value_slot(key);
-            if (en) {
-                en->creator_ptr = creator_ptr;
-                en->ifcname.takeover(tmp);
-                en->ns = ns;
-                en->classname = classname;
-                en->creatorname = creatorname;
-                en->hash = wrapper;
-                en->hashvalue = hash;
-                en->script = script;
-                en->modulename = modulename;
-                en->handle = uints(handle.touint64());
-                en->keylen = key.len();
-                return true;
-            }
-        }
 
-        return false;
+        return _hash.insert_value_slot(key, [&](entry& en) {
+            en.creator_ptr = creator_ptr;
+            en.ifcname.takeover(tmp);
+            en.ns = ns;
+            en.classname = classname;
+            en.creatorname = creatorname;
+            en.hash = wrapper;
+            en.hashvalue = hash;
+            en.script = script;
+            en.modulename = modulename;
+            en.handle = uints(handle.touint64());
+            en.keylen = key.len();
+        });
     }
 
     virtual dynarray<creator>& find_interface_creators(const regex& name, dynarray<creator>& dst)
@@ -150,20 +140,16 @@ public:
         //interface creator names:
         // [ns1::[ns2:: ...]]::class.creator
 
-        GUARDTHIS(_mx);
-
-        auto i = _hash.begin();
-        auto ie = _hash.end();
-        for (; i != ie; ++i) {
-            if (i->script)
-                continue;
+        _hash.for_each([&](const entry& en) {
+            if (en.script)
+                return;
 
-            if (name.match(token(*i))) {
+            if (name.match(token(en))) {
                 creator* p = dst.add();
-                p->creator_ptr = i->creator_ptr;
-                p->name = token(*i);
+                p->creator_ptr = en.creator_ptr;
+                p->name = token(en);
             }
-        }
+        });
 
         return dst;
     }
@@ -184,27 +170,23 @@ public:
         token classname = ns.cut_right_group_back("::"_T);
         token creatorname = classname.cut_right('.', token::cut_trait_remove_sep_default_empty());
 
-        GUARDTHIS(_mx);
-
-        auto i = _hash.begin();
-        auto ie = _hash.end();
-        for (; i != ie; ++i) {
-            if (!script.is_null() && script != i->script)
-                continue;
+        _hash.for_each([&](const entry& en) {
+            if (!script.is_null() && script != en.script)
+                return;
 
-            if (i->classname != classname)
-                continue;
+            if (en.classname != classname)
+                return;
 
-            if (creatorname && i->creatorname != creatorname)
-                continue;
+            if (creatorname && en.creatorname != creatorname)
+                return;
 
-            if (ns && i->ns != ns)
-                continue;
+            if (ns && en.ns != ns)
+                return;
 
             creator* p = dst.add();
-            p->creator_ptr = i->creator_ptr;
-            p->name = token(*i);
-        }
+            p->creator_ptr = en.creator_ptr;
+            p->name = token(en);
+        });
 
         return dst;
     }
@@ -217,31 +199,27 @@ public:
         token classname = ns.cut_right_group_back("::"_T);
         token creatorname = classname.cut_right('.', token::cut_trait_remove_sep_default_empty());
 
-        GUARDTHIS(_mx);
-
-        auto i = _hash.begin();
-        auto ie = _hash.end();
-        for (; i != ie; ++i) {
-            if (i->script)
-                continue;
+        _hash.for_each([&](const entry& en) {
+            if (en.script)
+                return;
 
-            if (i->classname != classname)
-                continue;
+            if (en.classname != classname)
+                return;
 
-            if (creatorname && i->creatorname != creatorname)
-                continue;
+            if (creatorname && en.creatorname != creatorname)
+                return;
 
-            token ins = i->ns;
+            token ins = en.ns;
             if (!script.is_null() && (!ins.consume_end(script) || !ins.consume_end("::"_T)))
-                continue;
+                return;
 
             if (ns && ins != ns)
-                continue;
+                return;
 
             creator* p = dst.add();
-            p->creator_ptr = i->creator_ptr;
-            p->name = token(*i);
-        }
+            p->creator_ptr = en.creator_ptr;
+            p->name = token(en);
+        });
 
         return dst;
     }
@@ -251,21 +229,19 @@ public:
         zstring str = iface;
         str.get_str() << "@client-" << hash << '.' << client;
 
-        GUARDTHIS(_mx);
+        interface_register::client_fn fn = 0;
 
-        const entry* en = _hash.find_value(str);
+        _hash.find_value(str, [&](const entry& en) {
+            if (en.hashvalue != hash)
+                return;
 
-        if (en) {
-            if (en->hashvalue != hash)
-                return 0;
+            if (module && !en.modulename.ends_with_icase(module))
+                return;
 
-            if (module && !en->modulename.ends_with_icase(module))
-                return 0;
+            fn = (interface_register::client_fn)en.creator_ptr;
+        });
 
-            return (interface_register::client_fn)en->creator_ptr;
-        }
-
-        return 0;
+        return fn;
     }
 
     virtual void* get_interface_maker(const token& name, const token& script) const
@@ -281,24 +257,20 @@ public:
         token ns = iface;
         token classname = ns.cut_right_group_back("::"_T);
 
-        GUARDTHIS(_mx);
-
-        auto i = _hash.begin();
-        auto ie = _hash.end();
-        for (; i != ie; ++i) {
-            if (i->hashvalue != hash)
-                continue;
+        _hash.for_each([&](const entry& en) {
+            if (en.hashvalue != hash)
+                return;
 
-            if (i->hash != "client"_T)
-                continue;
+            if (en.hash != "client"_T)
+                return;
 
-            if (i->classname != classname || i->ns != ns)
-                continue;
+            if (en.classname != classname || en.ns != ns)
+                return;
 
             interface_register::creator* p = dst.add();
-            p->name = i->script;
-            p->creator_ptr = i->creator_ptr;
-        }
+            p->name = en.script;
+            p->creator_ptr = en.creator_ptr;
+        });
 
         return dst;
     }
@@ -313,11 +285,13 @@ public:
 
     virtual interface_register::wrapper_fn find_wrapper(const token& ifcname) const
     {
-        GUARDTHIS(_mx);
+        interface_register::wrapper_fn fn = 0;
 
-        const entry* en = _hash.find_value(ifcname);
+        _hash.find_value(ifcname, [&](const entry& en) {
+            fn = (interface_register::wrapper_fn)en.creator_ptr;
+        });
 
-        return en ? (interface_register::wrapper_fn)en->creator_ptr : 0;
+        return fn;
     }
 
     virtual void setup(const token& path, interface_register::fn_log_t logfn, interface_register::fn_acc_t access, interface_register::fn_getlog_t getlogfn)
@@ -406,8 +380,6 @@ public:
 
     bool notify_module_unload(uints handle, binstring* bstr, dynarray<interface_register::unload_entry>& ens)
     {
-        GUARDTHIS(_mx);
-
         if (handle == 0) {
             //send notification after reload
             zstring str;
@@ -418,29 +390,28 @@ public:
 
                 (str.get_str() = nsc) << "@unload"_T;
 
-                const entry* en = _hash.find_value(str);
-                if (!en)
+                intergen_interface::fn_unload_client fn = find_unload_fn(str);
+                if (!fn)
                     continue;
 
-                intergen_interface::fn_unload_client fn = (intergen_interface::fn_unload_client)en->creator_ptr;
-
                 fn(""_T, ""_T, uen.bstrlen > 0 ? bstr : 0);
 
             }
             return true;
         }
 
-        //find clients residing in given dll
-        auto b = _hash.begin();
-        auto e = _hash.end();
-
-        for (; b != e; ) {
-            auto& en = *b;
-            ++b;
+        //take out clients residing in given dll, unload handlers are invoked outside of the shard locks
+        dynarray<entry> clients;
 
+        _hash.erase_if([&](entry& en) {
             if (en.handle != handle || en.hash != "client"_T)
-                continue;
+                return false;
+
+            *clients.add() = std::move(en);
+            return true;
+        });
 
+        for (entry& en : clients) {
             uints len = bstr->len();
 
             unload_client(en, bstr);
@@ -449,8 +420,6 @@ public:
             ue->ifcname.takeover(en.ifcname);
             ue->bstrofs = down_cast<uint>(len);
             ue->bstrlen = down_cast<uint>(bstr->len() - len);
-
-            RASSERT(_hash.erase_value_slot(&en, token(ue->ifcname.ptr(), ue->ifcname.ptr() + en.keylen)));
         }
 
         return true;
@@ -458,6 +427,17 @@ public:
 
 private:
 
+    intergen_interface::fn_unload_client find_unload_fn(const token& name) const
+    {
+        intergen_interface::fn_unload_client fn = 0;
+
+        _hash.find_value(name, [&](const entry& en) {
+            fn = (intergen_interface::fn_unload_client)en.creator_ptr;
+        });
+
+        return fn;
+    }
+
     bool unload_client(entry& cen, binstring* bstr)
     {
         const token& client = cen.script;
@@ -466,12 +446,10 @@ private:
         zstring str = cen.ns_class();
         str.get_str() << "@unload"_T;
 
-        const entry* en = _hash.find_value(str);
-        if (!en)
+        intergen_interface::fn_unload_client fn = find_unload_fn(str);
+        if (!fn)
             return true;
 
-        intergen_interface::fn_unload_client fn = (intergen_interface::fn_unload_client)en->creator_ptr;
-
         return fn(client, cen.modulename, bstr);
     }
 
@@ -41,10 +41,13 @@
 #include "../singleton.h"
 #include "../timer.h"
 
+#include <atomic>
+
 namespace profiler
 {
 
 auto& g_backend = PROCWIDE_SINGLETON(backend*);
+auto& g_backend_serial = PROCWIDE_SINGLETON(std::atomic<uint>);
 
 uint64 now()
 {
@@ -59,14 +62,14 @@ void set_thread_name(const char* name)
 
 uint64 create_transient_link()
 {
-    static volatile uint32 link;
-    return atomic::inc(&link);
+    static std::atomic<uint32> link;
+    return ++link;
 }
 
 uint64 create_fixed_link()
 {
-    static volatile uint32 link;
-    return atomic::inc(&link) | ((uint64)1 << 32);
+    static std::atomic<uint32> link;
+    return ++link | ((uint64)1 << 32);
 }
 
 void push_link(uint64 link)
@@ -75,6 +78,12 @@ void push_link(uint64 link)
         g_backend->push_link(link);
 }
 
+void counter(const char* name, int64 value)
+{
+    if (g_backend)
+        g_backend->counter(name, value);
+}
+
 void push_number(const char* label, uint value)
 {
     if (g_backend)
@@ -136,6 +145,17 @@ void end()
 void set_backend(backend* backend)
 {
     g_backend = backend;
+    ++g_backend_serial;
+}
+
+bool is_active()
+{
+    return g_backend != 0;
+}
+
+uint backend_serial()
+{
+    return g_backend_serial.load(std::memory_order_relaxed);
 }
 
 } // namespace profiler
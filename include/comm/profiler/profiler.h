@@ -55,10 +55,18 @@ public:
     virtual void push_string(const char* string) = 0;
     virtual void push_number(const char* label, uint value) = 0;
     virtual void push_link(uint64 link) = 0;
+    ///Set value of a named counter, sampled over time
+    virtual void counter(const char* name, int64 value) {}
 };
 
 void set_backend(backend* backend);
 
+//@return true if a backend is set
+bool is_active();
+
+//@return serial number of the current backend, changed by each set_backend() call
+uint backend_serial();
+
 void frame();
 void gpu_frame();
 uint64 get_token(const char* name);
@@ -67,6 +75,7 @@ void begin(const char* name, uint8 r = 0xa0, uint8 g = 0xa0, uint8 b = 0xa0);
 void push_string(const char* string);
 void push_number(const char* label, uint value);
 void push_link(uint64 link);
+void counter(const char* name, int64 value);
 void end();
 void set_thread_name(const char* name);
 void begin_gpu(const coid::token& name, uint64 timestamp, uint64 order);
@@ -85,6 +94,27 @@ struct scope final
     ~scope() { end(); }
 };
 
+///Token of a fixed name, fetched again from the backend after set_backend()
+//@note not thread safe, use as a thread_local object
+struct cached_token final
+{
+    explicit cached_token(const char* name) : _name(name) {}
+
+    operator uint64() {
+        const uint serial = backend_serial();
+        if (_serial != serial) {
+            _token = get_token(_name);
+            _serial = serial;
+        }
+        return _token;
+    }
+
+private:
+    const char* _name;
+    uint64 _token = 0;
+    uint _serial = 0;
+};
+
 } // namespace profiler
 
 #define CPU_PROFILE_CONCAT2(a, b) a ## b
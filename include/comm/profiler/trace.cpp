@@ -0,0 +1,319 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2020
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include "trace.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+namespace profiler
+{
+
+////////////////////////////////////////////////////////////////////////////////
+trace_backend::trace_backend(uint events_per_thread)
+{
+    //round up to power of 2
+    uint cap = 1;
+    while (cap < events_per_thread)
+        cap <<= 1;
+    _capacity = cap;
+
+    static std::atomic<uint64> serial(0);
+    _serial = ++serial;
+    _start = now();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+trace_backend::~trace_backend()
+{
+    _buffers.for_each([](thread_buffer* b) {
+        delete[] b->events;
+        delete b;
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void trace_backend::clear()
+{
+    std::unique_lock<std::mutex> lock(_sync);
+
+    _buffers.for_each([](thread_buffer* b) {
+        b->head.store(0, std::memory_order_release);
+    });
+    _start = now();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+trace_backend::thread_buffer* trace_backend::local_buffer()
+{
+    struct cache {
+        uint64 serial;
+        thread_buffer* buffer;
+    };
+    static thread_local cache c = { 0, 0 };
+
+    if (c.serial != _serial) {
+        c.buffer = create_buffer();
+        c.serial = _serial;
+    }
+    return c.buffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+trace_backend::thread_buffer* trace_backend::create_buffer()
+{
+    thread_buffer* b = new thread_buffer;
+    b->events = new event[_capacity];
+    b->mask = _capacity - 1;
+    b->head = 0;
+
+    std::unique_lock<std::mutex> lock(_sync);
+    b->id = uint(_buffers.size()) + 1;
+    b->name << "thread " << b->id;
+    _buffers.push(b);
+
+    return b;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void trace_backend::frame()
+{
+    write(etype::frame, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64 trace_backend::get_token(const char* name)
+{
+    coid::token tname = name;
+
+    std::unique_lock<std::mutex> lock(_sync);
+
+    const coid::charstr* p = _names.find_if([&](const coid::charstr& s) { return s == tname; });
+    if (p)
+        return uint64(p - _names.ptr()) + 1;
+
+    *_names.add() = tname;
+    return _names.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void trace_backend::begin(uint64 token, uint8 r, uint8 g, uint8 b)
+{
+    write(etype::begin, token);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void trace_backend::end()
+{
+    write(etype::end, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void trace_backend::set_thread_name(const char* name)
+{
+    thread_buffer* b = local_buffer();
+
+    std::unique_lock<std::mutex> lock(_sync);
+    b->name = name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void trace_backend::push_number(const char* label, uint value)
+{
+    write(etype::number, value, label);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void trace_backend::push_link(uint64 link)
+{
+    write(etype::link, link);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void trace_backend::counter(const char* name, int64 value)
+{
+    write(etype::counter, uint64(value), name);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void write_string(FILE* f, coid::token str)
+{
+    fputc('"', f);
+    for (char c : str) {
+        if (c == '"' || c == '\\')
+            fputc('\\', f);
+        if (uint8(c) < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool trace_backend::write_json(const char* path) const
+{
+    FILE* f = fopen(path, "wt");
+    if (!f)
+        return false;
+
+    std::unique_lock<std::mutex> lock(_sync);
+
+    struct link_event {
+        uint64 link;
+        uint64 time;
+        uint tid;
+    };
+    coid::dynarray<link_event> links;
+
+    const uint64 start = _start;
+    //timestamps in microseconds with ns precision
+    struct timestamp {
+        char buf[32];
+        const char* c_str() const { return buf; }
+    };
+    auto ts = [start](uint64 t) {
+        const uint64 d = t > start ? t - start : 0;
+        timestamp r;
+        snprintf(r.buf, sizeof(r.buf), "%llu.%03u", (unsigned long long)(d / 1000), uint(d % 1000));
+        return r;
+    };
+
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+    bool first = true;
+    auto sep = [&]() {
+        if (!first)
+            fputs(",\n", f);
+        first = false;
+    };
+
+    _buffers.for_each([&](const thread_buffer* b) {
+        sep();
+        fprintf(f, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", b->id);
+        write_string(f, b->name);
+        fputs("}}", f);
+
+        const uint64 head = b->head.load(std::memory_order_acquire);
+        const uint64 tail = head > b->mask ? head - b->mask : 0;
+
+        //args pushed into the current scope are written with its end event
+        coid::dynarray<const event*> args;
+        int depth = 0;
+
+        for (uint64 i = tail; i < head; ++i) {
+            const event& e = b->events[i & b->mask];
+
+            switch (e.type) {
+            case etype::begin: {
+                ++depth;
+                const coid::charstr* name = e.value > 0 && e.value <= _names.size() ? &_names[e.value - 1] : 0;
+                sep();
+                fputs("{\"ph\":\"B\",\"name\":", f);
+                write_string(f, name ? coid::token(*name) : coid::token("<unknown>"));
+                fprintf(f, ",\"pid\":1,\"tid\":%u,\"ts\":%s}", b->id, ts(e.time).c_str());
+                break;
+            }
+            case etype::end:
+                //skip ends of scopes that begun before the oldest event in the ring
+                if (depth == 0)
+                    break;
+                --depth;
+                sep();
+                fprintf(f, "{\"ph\":\"E\",\"pid\":1,\"tid\":%u,\"ts\":%s", b->id, ts(e.time).c_str());
+                if (args.size()) {
+                    fputs(",\"args\":{", f);
+                    for (uints k = 0; k < args.size(); ++k) {
+                        if (k) fputc(',', f);
+                        write_string(f, args[k]->label);
+                        fprintf(f, ":%llu", (unsigned long long)args[k]->value);
+                    }
+                    fputc('}', f);
+                    args.reset();
+                }
+                fputc('}', f);
+                break;
+            case etype::number:
+                if (depth > 0)
+                    args.push(&e);
+                break;
+            case etype::link: {
+                link_event* le = links.add();
+                le->link = e.value;
+                le->time = e.time;
+                le->tid = b->id;
+                break;
+            }
+            case etype::counter:
+                sep();
+                fputs("{\"ph\":\"C\",\"name\":", f);
+                write_string(f, e.label);
+                fprintf(f, ",\"pid\":1,\"ts\":%s,\"args\":{\"value\":%lld}}", ts(e.time).c_str(), (long long)e.value);
+                break;
+            case etype::frame:
+                sep();
+                fprintf(f, "{\"ph\":\"i\",\"name\":\"frame\",\"s\":\"g\",\"pid\":1,\"tid\":%u,\"ts\":%s}", b->id, ts(e.time).c_str());
+                break;
+            }
+        }
+    });
+
+    //flow arrows from the first occurrence of a link to the later ones
+    std::sort(links.ptr(), links.ptre(), [](const link_event& a, const link_event& b) {
+        return a.link != b.link ? a.link < b.link : a.time < b.time;
+    });
+
+    for (uints i = 0; i < links.size(); ) {
+        uints j = i + 1;
+        while (j < links.size() && links[j].link == links[i].link)
+            ++j;
+
+        if (j - i > 1) {
+            for (uints k = i; k < j; ++k) {
+                const char* ph = k == i ? "s" : (k + 1 == j ? "f" : "t");
+                sep();
+                fprintf(f, "{\"ph\":\"%s\",\"name\":\"link\",\"cat\":\"link\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":%s%s}",
+                    ph, (unsigned long long)links[k].link, links[k].tid, ts(links[k].time).c_str(), k == i ? "" : ",\"bp\":\"e\"");
+            }
+        }
+        i = j;
+    }
+
+    fputs("\n]}\n", f);
+
+    bool ok = ferror(f) == 0;
+    fclose(f);
+    return ok;
+}
+
+} // namespace profiler
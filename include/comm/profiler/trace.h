@@ -0,0 +1,161 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Outerra.
+ * Portions created by the Initial Developer are Copyright (C) 2020
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#pragma once
+
+#include "profiler.h"
+#include "../dynarray.h"
+#include "../str.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace profiler
+{
+
+/**
+    Profiler backend recording a timeline into per-thread ring buffers, exportable as Chrome trace
+    JSON (chrome://tracing, ui.perfetto.dev).
+
+    Each thread writes only into its own ring buffer, without locking; when a buffer fills up
+    the oldest events are overwritten. Links pushed with push_link() are exported as flow arrows
+    from the first scope that pushed the link to the scopes that pushed it later.
+
+    Usage:
+        profiler::trace_backend trace;
+        profiler::set_backend(&trace);
+        ...
+        trace.set_recording(false);
+        trace.write_json("trace.json");
+
+    @note names passed to get_token() are copied, labels given to push_number() and counter()
+    must be string literals (stored by pointer); strings, colors and gpu events are not recorded
+**/
+class trace_backend : public backend
+{
+public:
+
+    //@param events_per_thread capacity of the ring buffer of each thread
+    explicit trace_backend(uint events_per_thread = 1 << 16);
+    ~trace_backend();
+
+    ///Enable or disable recording of new events
+    void set_recording(bool enable) { _recording = enable; }
+    bool is_recording() const { return _recording; }
+
+    ///Discard recorded events
+    void clear();
+
+    ///Write recorded events in Chrome trace event format
+    //@note should be called with recording stopped, events written concurrently may be torn
+    //@return false if the file couldn't be written
+    bool write_json(const char* path) const;
+
+    //@{ backend interface
+    void frame() override;
+    void gpu_frame() override {}
+    uint64 get_token(const char* name) override;
+    void begin(uint64 token, uint8 r, uint8 g, uint8 b) override;
+    void end() override;
+    void begin_gpu(const coid::token& name, uint64 timestamp, uint64 order) override {}
+    void end_gpu(const coid::token& name, uint64 timestamp, uint64 order) override {}
+    void set_thread_name(const char* name) override;
+    void push_string(const char* string) override {}
+    void push_number(const char* label, uint value) override;
+    void push_link(uint64 link) override;
+    void counter(const char* name, int64 value) override;
+    //@}
+
+private:
+
+    enum class etype : uint8 {
+        begin,
+        end,
+        number,                         //< argument of the enclosing scope
+        link,
+        counter,
+        frame,
+    };
+
+    struct event
+    {
+        uint64 time;
+        uint64 value;                   //< token, link, number
+        const char* label;
+        etype type;
+    };
+
+    struct thread_buffer
+    {
+        uint id;
+        coid::charstr name;
+        event* events;
+        uint mask;
+
+        std::atomic<uint64> head;       //< total number of events written
+
+
+        void push(etype type, uint64 value, const char* label = 0) {
+            const uint64 h = head.load(std::memory_order_relaxed);
+            event& e = events[h & mask];
+            e.time = now();
+            e.value = value;
+            e.label = label;
+            e.type = type;
+            head.store(h + 1, std::memory_order_release);
+        }
+    };
+
+    //@return buffer of the current thread
+    thread_buffer* local_buffer();
+
+    thread_buffer* create_buffer();
+
+    void write(etype type, uint64 value, const char* label = 0) {
+        if (_recording)
+            local_buffer()->push(type, value, label);
+    }
+
+    mutable std::mutex _sync;
+    coid::dynarray<thread_buffer*> _buffers;
+    coid::dynarray<coid::charstr> _names;   //< token names, token = index + 1
+
+    uint _capacity;
+    uint64 _serial;                     //< unique instance id for thread local buffer caches
+    uint64 _start;
+
+    volatile bool _recording = true;
+};
+
+} // namespace profiler
@@ -109,6 +109,71 @@ void thread::set_affinity_mask(uint64 mask)
 #endif
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool thread::set_affinity(const cpuset& cpus)
+{
+    if (cpus.is_empty())
+        return false;
+
+#ifdef SYSTYPE_WIN
+    uint group = 0;
+    while (!cpus.group_mask(group))
+        ++group;
+
+    GROUP_AFFINITY ga;
+    ::memset(&ga, 0, sizeof(ga));
+    ga.Group = (WORD)group;
+    ga.Mask = (KAFFINITY)cpus.group_mask(group);
+
+    return SetThreadGroupAffinity(GetCurrentThread(), &ga, 0) != 0;
+#else
+    cpu_set_t* set = CPU_ALLOC(cpuset::MAX_CPUS);
+    const size_t size = CPU_ALLOC_SIZE(cpuset::MAX_CPUS);
+    CPU_ZERO_S(size, set);
+
+    cpus.for_each([&](uint cpu) {
+        CPU_SET_S(cpu, size, set);
+    });
+
+    bool rv = pthread_setaffinity_np(pthread_self(), size, set) == 0;
+    CPU_FREE(set);
+    return rv;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool thread::get_affinity(cpuset& cpus)
+{
+    cpus.reset();
+
+#ifdef SYSTYPE_WIN
+    GROUP_AFFINITY ga;
+    if (!GetThreadGroupAffinity(GetCurrentThread(), &ga))
+        return false;
+
+    for (uint i = 0; i < 64; ++i) {
+        if (ga.Mask & ((KAFFINITY)1 << i))
+            cpus.set(ga.Group * 64 + i);
+    }
+    return true;
+#else
+    cpu_set_t* set = CPU_ALLOC(cpuset::MAX_CPUS);
+    const size_t size = CPU_ALLOC_SIZE(cpuset::MAX_CPUS);
+    CPU_ZERO_S(size, set);
+
+    bool rv = pthread_getaffinity_np(pthread_self(), size, set) == 0;
+    if (rv) {
+        for (uint i = 0; i < cpuset::MAX_CPUS; ++i) {
+            if (CPU_ISSET_S(i, size, set))
+                cpus.set(i);
+        }
+    }
+
+    CPU_FREE(set);
+    return rv;
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 thread thread::create_new_fn( const function<void*()>& fn, void* context, const token& name )
 {
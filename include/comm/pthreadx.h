@@ -58,6 +58,75 @@ COID_NAMESPACE_BEGIN
     typedef pthread_t           thread_t;
 #endif
 
+////////////////////////////////////////////////////////////////////////////////
+///Set of logical processors, not limited to 64 cpus
+struct cpuset
+{
+    enum { MAX_CPUS = 1024 };
+
+    cpuset() { reset(); }
+
+    void reset() {
+        for (uint i = 0; i < NWORDS; ++i)
+            _bits[i] = 0;
+    }
+
+    void set(uint cpu) {
+        if (cpu < MAX_CPUS)
+            _bits[cpu >> 6] |= uint64(1) << (cpu & 63);
+    }
+
+    void clear(uint cpu) {
+        if (cpu < MAX_CPUS)
+            _bits[cpu >> 6] &= ~(uint64(1) << (cpu & 63));
+    }
+
+    bool test(uint cpu) const {
+        return cpu < MAX_CPUS && (_bits[cpu >> 6] & (uint64(1) << (cpu & 63))) != 0;
+    }
+
+    ///Add all cpus from another set
+    cpuset& operator |= (const cpuset& other) {
+        for (uint i = 0; i < NWORDS; ++i)
+            _bits[i] |= other._bits[i];
+        return *this;
+    }
+
+    bool is_empty() const {
+        for (uint i = 0; i < NWORDS; ++i)
+            if (_bits[i])
+                return false;
+        return true;
+    }
+
+    //@return number of cpus in the set
+    uint count() const {
+        uint n = 0;
+        for (uint i = 0; i < NWORDS; ++i)
+            for (uint64 w = _bits[i]; w; w &= w - 1)
+                ++n;
+        return n;
+    }
+
+    //@return 64-bit mask of cpus in given group of 64 cpus
+    uint64 group_mask(uint group) const {
+        return group < NWORDS ? _bits[group] : 0;
+    }
+
+    ///Invoke fn(uint cpu) for each cpu in the set, in ascending order
+    template <typename Func>
+    void for_each(Func fn) const {
+        for (uint i = 0; i < MAX_CPUS; ++i)
+            if (test(i))
+                fn(i);
+    }
+
+private:
+    enum { NWORDS = MAX_CPUS / 64 };
+
+    uint64 _bits[NWORDS];
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 struct thread
 {
@@ -128,6 +197,16 @@ public:
     // sets a processor affinity mask for current thread
     static void set_affinity_mask(uint64 mask);
 
+    ///Set processor affinity of the current thread
+    //@note on Windows a thread can run only on processors from a single processor group, the group
+    /// of the lowest cpu in the set is used
+    //@return false if the affinity could not be set
+    static bool set_affinity(const cpuset& cpus);
+
+    ///Get processor affinity of the current thread
+    //@return false if the affinity could not be retrieved
+    static bool get_affinity(cpuset& cpus);
+
     //@{ Static methods dealing with the thread currently running
 
     //@return context info given when current thread was created
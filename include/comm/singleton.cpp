@@ -96,7 +96,7 @@ class global_singleton_manager
 
 public:
 
-    global_singleton_manager() : mx(500, false)
+    global_singleton_manager() : mx(500, true)
     {
         last = 0;
         count = 0;
@@ -67,6 +67,13 @@ public:
         this->push_back(std::forward<T>(item));
     }
 
+    ///Push multiple items under a single lock
+    void push(const T* items, uints n) {
+        GUARDTHIS(_mutex);
+        for (uints i = 0; i < n; ++i)
+            this->push_back(items[i]);
+    }
+
     bool pop(T& item) { GUARDTHIS(_mutex); return this->pop_front(item); }
 
     void clear() { GUARDTHIS(_mutex); list<T>::clear(); }
@@ -75,6 +82,13 @@ public:
 
     void push_front(T&& item) { GUARDTHIS(_mutex); list<T>::push_front(std::forward<T>(item)); }
 
+    ///Push multiple items to front under a single lock
+    void push_front(const T* items, uints n) {
+        GUARDTHIS(_mutex);
+        for (uints i = 0; i < n; ++i)
+            list<T>::push_front(items[i]);
+    }
+
     bool is_empty() const { GUARDTHIS(_mutex); return list<T>::is_empty(); }
 };
 
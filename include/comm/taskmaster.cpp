@@ -1,6 +1,7 @@
 #include "net_ul.h"
 #include "profiler/profiler.h"
 #include "taskmaster.h"
+#include "alloc/commalloc.h"
 
 COID_NAMESPACE_BEGIN
 
@@ -8,33 +9,335 @@ const taskmaster::signal_handle taskmaster::invalid_signal = taskmaster::signal_
 
 taskmaster::~taskmaster() {
     terminate(false);
+
+    for (uint i = 0; i < _nsignal_pages; ++i)
+        delete[] _signal_pages[i];
+
+    //heaps of live threads are deleted when the threads exit
+    std::unique_lock<std::mutex> lock(heap_sync());
+
+    _heaps.for_each([](task_heap* heap) {
+        if (heap->owner == thread::invalid())
+            delete heap;
+        else
+            heap->master = 0;
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct taskmaster::thread_heaps
+{
+    dynarray<task_heap*> heaps;
+
+    ~thread_heaps() {
+        release_heaps(heaps);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+std::mutex& taskmaster::heap_sync()
+{
+    static std::mutex sync;
+    return sync;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void taskmaster::release_heaps(dynarray<task_heap*>& heaps)
+{
+    std::unique_lock<std::mutex> lock(heap_sync());
+
+    heaps.for_each([](task_heap* heap) {
+        taskmaster* tm = heap->master;
+        if (!tm) {
+            //taskmaster already destroyed
+            delete heap;
+            return;
+        }
+
+        //return batched blocks, the heap keeps its free lists and remote blocks for the thread that adopts it
+        std::unique_lock<std::mutex> alock(tm->_alloc_sync);
+        heap->flush();
+        heap->owner = thread::invalid();
+    });
+    heaps.reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+taskmaster::task_heap::~task_heap()
+{
+    slabs.for_each([](void* p) {
+        memaligned_free(p);
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void taskmaster::task_heap::flush()
+{
+    if (!batch_head)
+        return;
+
+    std::atomic<free_block*>& list = batch_heap->remote[batch_class];
+    free_block* head = list.load(std::memory_order_relaxed);
+    do {
+        batch_tail->next = head;
+    }
+    while (!list.compare_exchange_weak(head, batch_head, std::memory_order_release, std::memory_order_relaxed));
+
+    batch_heap = 0;
+    batch_head = batch_tail = 0;
+    batch_count = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+taskmaster::task_heap::free_block* taskmaster::task_heap::refill(uint sclass)
+{
+    //take over blocks returned by other threads
+    free_block* b = remote[sclass].exchange(0, std::memory_order_acquire);
+    if (b)
+        return b;
+
+    const uints bsize = sizeof(granule) << sclass;
+    uint8* slab = (uint8*)memaligned_alloc(bsize * SLAB_BLOCKS, sizeof(granule));
+    slabs.push(slab);
+
+    for (uint i = SLAB_BLOCKS; i-- > 0; ) {
+        free_block* fb = reinterpret_cast<free_block*>(slab + i * bsize);
+        fb->next = b;
+        b = fb;
+    }
+
+    return b;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+taskmaster::task_heap* taskmaster::find_heap()
+{
+    const int order = get_order();
+    if (order >= 0 && get_master() == this)
+        return &_threads[order].heap;
+
+    static thread_local thread_heaps owned;
+
+    std::unique_lock<std::mutex> lock(_alloc_sync);
+
+    thread_t self = thread::self();
+    task_heap* orphan = 0;
+
+    for (task_heap* heap : _heaps) {
+        if (heap->owner == self)
+            return heap;
+        if (!orphan && heap->owner == thread::invalid())
+            orphan = heap;
+    }
+
+    //adopt heap of an exited thread, or create a new one
+    task_heap* heap = orphan;
+    if (!heap) {
+        heap = new task_heap;
+        heap->master = this;
+        _heaps.push(heap);
+    }
+    heap->owner = self;
+    owned.heaps.push(heap);
+
+    return heap;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool taskmaster::get_metrics(metrics& m) const
+{
+    m = metrics();
+
+#ifdef COID_TASKMASTER_METRICS
+    auto collect = [&m](const metrics_block& b, metrics::thread& t) {
+        t.tasks = b.tasks.load(std::memory_order_relaxed);
+        t.busy_ns = b.busy_ns.load(std::memory_order_relaxed);
+        t.idle_ns = b.idle_ns.load(std::memory_order_relaxed);
+        t.steals = b.steals.load(std::memory_order_relaxed);
+        t.wait_help_ns = b.wait_help_ns.load(std::memory_order_relaxed);
+        t.wait_spin_ns = b.wait_spin_ns.load(std::memory_order_relaxed);
+
+        for (int i = 0; i < (int)EPriority::COUNT; ++i) {
+            metrics::priority& p = m.prio[i];
+            p.tasks += b.prio_tasks[i].load(std::memory_order_relaxed);
+            p.latency_ns += b.prio_latency_ns[i].load(std::memory_order_relaxed);
+            p.max_latency_ns = std::max(p.max_latency_ns, b.prio_max_latency_ns[i].load(std::memory_order_relaxed));
+        }
+    };
+
+    m.workers.alloc(_threads.size());
+    _threads.for_each([&](const threadinfo& ti, uints id) {
+        collect(ti.stats, m.workers[id]);
+    });
+    collect(_ext_stats, m.external);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void taskmaster::reset_metrics()
+{
+#ifdef COID_TASKMASTER_METRICS
+    _threads.for_each([](threadinfo& ti) {
+        ti.stats.reset();
+    });
+    _ext_stats.reset();
+    _published = metrics();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void taskmaster::publish_metrics()
+{
+#ifdef COID_TASKMASTER_METRICS
+    metrics m;
+    get_metrics(m);
+
+    static const char* prio_tasks[] = { "taskmaster tasks high", "taskmaster tasks normal", "taskmaster tasks low" };
+    static const char* prio_latency[] = { "taskmaster latency high [us]", "taskmaster latency normal [us]", "taskmaster latency low [us]" };
+    static_assert(sizeof(prio_tasks) / sizeof(prio_tasks[0]) == (int)EPriority::COUNT, "priority names mismatch");
+
+    for (int i = 0; i < (int)EPriority::COUNT; ++i) {
+        const uint64 ntasks = m.prio[i].tasks - _published.prio[i].tasks;
+        const uint64 latency = m.prio[i].latency_ns - _published.prio[i].latency_ns;
+
+        profiler::counter(prio_tasks[i], int64(ntasks));
+        profiler::counter(prio_latency[i], ntasks ? int64(latency / ntasks / 1000) : 0);
+    }
+
+    //deltas since the last publish
+    uint64 busy = 0, idle = 0, steals = 0, help = 0, spin = 0;
+    auto accumulate = [&](const metrics::thread& t, const metrics::thread& prev) {
+        busy += t.busy_ns - prev.busy_ns;
+        idle += t.idle_ns - prev.idle_ns;
+        steals += t.steals - prev.steals;
+        help += t.wait_help_ns - prev.wait_help_ns;
+        spin += t.wait_spin_ns - prev.wait_spin_ns;
+    };
+
+    const metrics::thread none;
+    m.workers.for_each([&](const metrics::thread& t, uints id) {
+        accumulate(t, id < _published.workers.size() ? _published.workers[id] : none);
+    });
+
+    //external threads don't idle, their busy time would skew the utilization
+    steals += m.external.steals - _published.external.steals;
+    help += m.external.wait_help_ns - _published.external.wait_help_ns;
+    spin += m.external.wait_spin_ns - _published.external.wait_spin_ns;
+
+    profiler::counter("taskmaster utilization [%]", busy + idle ? int64(busy * 100 / (busy + idle)) : 0);
+    profiler::counter("taskmaster steals", int64(steals));
+    profiler::counter("taskmaster wait help [us]", int64(help / 1000));
+    profiler::counter("taskmaster wait spin [us]", int64(spin / 1000));
+
+    _published = std::move(m);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void taskmaster::place_threads(EPlacement placement)
+{
+    const cpu_topology& topo = cpu_topology::get();
+    const uint ncpus = uint(topo.cpus.size());
+    const uint nthreads = uint(_threads.size());
+
+    _nnodes = 1;
+
+    if (placement == EPlacement::NONE || ncpus == 0 || nthreads == 0)
+        return;
+
+    _nnodes = topo.nnodes;
+
+    if (placement == EPlacement::NUMA) {
+        //split workers into contiguous blocks per node
+        _threads.for_each([&](threadinfo& ti, uints id) {
+            ti.node = uint(id * topo.nnodes / nthreads);
+            ti.cpus = topo.node_cpus(ti.node);
+        });
+        return;
+    }
+
+    //topology order has SMT siblings next to each other
+    dynarray<const cpu_topology::logical_cpu*> order;
+    topo.cpus.for_each([&](const cpu_topology::logical_cpu& c) {
+        order.push(&c);
+    });
+
+    if (placement == EPlacement::SPREAD) {
+        std::stable_sort(order.ptr(), order.ptre(), [](const cpu_topology::logical_cpu* a, const cpu_topology::logical_cpu* b) {
+            return a->smt < b->smt;
+        });
+    }
+
+    _threads.for_each([&](threadinfo& ti, uints id) {
+        const cpu_topology::logical_cpu* c = order[id % ncpus];
+        ti.cpus.set(c->id);
+        ti.node = c->node;
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
 void* taskmaster::threadfunc( int order )
 {
     uint notify_counter = 0;
 
     get_order() = order;
+    get_master() = this;
+
+    ++_nstarted;
+
+    const threadinfo& ti = _threads[order];
+    if (!ti.cpus.is_empty())
+        thread::set_affinity(ti.cpus);
 
-    thread::set_affinity_mask((uint64)1 << order);
     coidlog_info("taskmaster", "thread " << order << " running");
     char tmp[64];
-    sprintf_s(tmp, "taskmaster %d", order);
+    snprintf(tmp, sizeof(tmp), "taskmaster %d", order);
     profiler::set_thread_name(tmp);
 
+    if (_mode == EScheduling::WORK_STEALING)
+    {
+        while (!_quitting) {
+            invoker_base* task = pop_task(order);
+            if (task)
+                run_task(task, order);
+            else
+                idle_wait(order);
+        }
+
+        coidlog_info("taskmaster", "thread " << order << " exiting");
+        return 0;
+    }
+
     do
     {
+#ifdef COID_TASKMASTER_METRICS
+        const uint64 t0 = metrics_time();
+        wait();
+        metrics_block& stats = _threads[order].stats;
+        stats.add(stats.idle_ns, metrics_time() - t0);
+#else
         wait();
+#endif
         if (_quitting) break;
 
-        invoker_base* task = 0;
-        for(int prio = 0; prio < (int)EPriority::COUNT; ++prio) {
+        //urgent deadline tasks first, then fixed priorities with their deadline tasks before the regular ones
+        invoker_base* task = pop_urgent();
+        for(int prio = 0; !task && prio < (int)EPriority::COUNT; ++prio) {
             const bool can_run = prio != (int)EPriority::LOW || order < _nlowprio_threads || order == -1;
-            if (can_run && _ready_jobs[prio].pop(task)) {
-                notify_counter = 0;
-                run_task(task, order);
-                break;
-            }
+            if (!can_run)
+                continue;
+            task = pop_deadline(prio);
+            if (!task && !_ready_jobs[prio].pop(task))
+                task = 0;
+        }
+
+        if (task) {
+            notify_counter = 0;
+            run_task(task, order);
         }
         
         if (!task) {
@@ -42,11 +42,18 @@
 #include "trait.h"
 #include "alloc/slotalloc.h"
 #include "bitrange.h"
+#include "radix.h"
 #include "sync/queue.h"
+#include "atomic/ws_deque.h"
+#include "atomic/futex.h"
 #include "pthreadx.h"
+#include "cpu_topology.h"
+#include "timer.h"
+#include "profiler/profiler.h"
 #include "log/logger.h"
 #include <mutex>
 #include <condition_variable>
+#include <algorithm>
 
 COID_NAMESPACE_BEGIN
 
@@ -59,12 +66,74 @@ COID_NAMESPACE_BEGIN
 
     When a thread is waiting for a signal it processes other tasks in queue.
 
+    Scheduling modes:
+        SHARED_QUEUE - all tasks go to a shared mutex-guarded queue per priority
+        WORK_STEALING - each worker has its own Chase-Lev deque per priority, tasks pushed from a worker go
+            to its deque and are popped in LIFO order, idle workers steal from other workers in FIFO order.
+            Tasks pushed from non-worker threads go to the shared queues. Priorities are honored across
+            the whole pool, a worker with NORMAL tasks in its deque steals HIGH tasks first.
+
     Basic usage:
         coid::taskmaster::signal_handle signal;
         for (int i = 0; i < 10; ++i) {
             taskmaster->push(coid::taskmaster::EPriority::NORMAL, &signal, [i](){ foo(i); });
         }
         taskmaster->wait(signal);
+
+    Task dependencies:
+        Instead of blocking a worker in wait(), a task can be pushed with a list of predecessor signals,
+        it's queued only after all of them become signaled:
+
+        coid::taskmaster::signal_handle physics, anim, culling;
+        taskmaster->push(EPriority::HIGH, &physics, [](){ step_physics(); });
+        taskmaster->then(physics, EPriority::HIGH, &anim, [](){ animate(); });
+        taskmaster->push(EPriority::HIGH, &culling, [](){ cull_static(); });
+        const coid::taskmaster::signal_handle deps[] = { anim, culling };
+        taskmaster->push_after(deps, 2, EPriority::HIGH, nullptr, [](){ submit(); });
+
+    Cancellation:
+        cancel(signal) marks all tasks associated with the signal as cancelled in O(1). Tasks that
+        haven't started yet are skipped when popped, without running their body, but still decrement
+        the signal so that waiters and dependent tasks proceed. Running tasks can poll is_cancelled()
+        to stop early.
+
+        coid::taskmaster::signal_handle tiles;
+        for (auto& t : visible_tiles)
+            taskmaster->push(EPriority::LOW, &tiles, [&t](){ load_tile(t); });
+        ...
+        taskmaster->cancel(tiles);      //camera moved away
+
+    Task memory:
+        Tasks up to 1kB (including captured arguments) are allocated from per-thread heaps without
+        locking, tasks released on another thread are returned to the owner heap in batches.
+        Larger tasks fall back to a shared pool guarded by a mutex.
+        Heaps of non-worker threads are orphaned when the thread exits and adopted by the next
+        non-worker thread that pushes tasks, so their count is bounded by the peak number of
+        concurrent producers.
+
+    Worker placement:
+        Workers are pinned according to the EPlacement policy using the detected cpu_topology.
+        With NUMA placement the workers form per-node pools; in WORK_STEALING mode the workers
+        always try to steal from workers on their own node before going to remote nodes.
+
+    Metrics:
+        When compiled with COID_TASKMASTER_METRICS, the taskmaster collects per-priority queue latency
+        and per-thread busy/idle/wait times into per-thread counters. Use get_metrics() for a snapshot
+        or call publish_metrics() once per frame to feed the profiler counters.
+        Tasks run from wait() count both into the busy time and the wait help time, so the wait
+        times must not be added to busy/idle times.
+
+    Profiling:
+        While a profiler backend is set, each push and run of a task emits a profiler scope linked
+        with push_link(), so the timeline shows which scope spawned which task. On headless machines
+        profiler::trace_backend can record it into a Chrome trace file.
+
+    Deadlines:
+        Tasks pushed with push_deadline() carry a target completion time. At their priority level they
+        are served before the regular tasks, earliest deadline first. After a part of their budget
+        elapses (half of it by default, or a lead time given per task) they become urgent and preempt
+        the queues of all priorities, and can be taken by any worker, so LOW priority streaming work
+        still completes in bounded time under a HIGH load.
 **/
 class taskmaster
 {
@@ -72,6 +141,7 @@ public:
     struct critical_section
     {
         volatile int32 value = 0;
+        std::atomic<uint32> nwaiters = {0};  //< number of threads parked on value
     };
 
     struct signal_handle
@@ -105,22 +175,58 @@ public:
         COUNT
     };
 
+    enum class EScheduling {
+        SHARED_QUEUE,                   //< shared queue per priority
+        WORK_STEALING,                  //< per-worker deques with work stealing
+
+        COUNT
+    };
+
+    ///Placement of worker threads on logical processors
+    enum class EPlacement {
+        NONE,                           //< no pinning, left to the os scheduler
+        COMPACT,                        //< pin to consecutive logical cpus, filling SMT siblings of a core first
+        SPREAD,                         //< pin to distinct physical cores first, SMT siblings used last
+        NUMA,                           //< workers split into per-node pools, each allowed to run on any cpu of its node
+
+        COUNT
+    };
+
     //@param nthreads total number of job threads to spawn
     //@param nlong_threads number of low-prio job threads (<= nthreads)
-    taskmaster(uint nthreads, uint nlowprio_threads)
+    //@param mode scheduling mode
+    //@param placement placement of worker threads on logical processors
+    taskmaster(uint nthreads, uint nlowprio_threads, EScheduling mode = EScheduling::SHARED_QUEUE, EPlacement placement = EPlacement::COMPACT)
         : _qsize(0)
+        , _nsleeping(0)
+        , _nstarted(0)
+        , _ndeadline(0)
+        , _deadline_window(2000000)
         , _quitting(false)
+        , _mode(mode)
         , _nlowprio_threads(nlowprio_threads)
     {
+        for (int i = 0; i < (int)EPriority::COUNT; ++i)
+            _nqueued[i] = 0;
+
         _taskdata.reserve_virtual(8192 * 16);
-        _signal_pool.resize(4096);
-        _free_signals.reserve(4096);
-        for (uint i = 0; i < _signal_pool.size(); ++i) {
-            _signal_pool[i].version = 0;
-            _free_signals.push(signal_handle(i));
-        }
+
+        static std::atomic<uint64> serial(0);
+        _serial = ++serial;
+
+        _free_signals = 0;
+        _nsignal_pages = 0;
+        for (uint i = 0; i < MAX_SIGNAL_PAGES; ++i)
+            _signal_pages[i] = 0;
+        grow_signal_pool();
+
+#ifdef COID_TASKMASTER_METRICS
+        _ext_stats.shared = true;
+#endif
 
         _threads.alloc(nthreads);
+        place_threads(placement);
+
         _threads.for_each([&](threadinfo& ti, uints id) {
             ti.order = uint(id);
             ti.master = this;
@@ -132,18 +238,279 @@ public:
 
     uints get_workers_count() const { return _threads.size(); }
 
+    EScheduling get_scheduling() const { return _mode; }
+
+    //@return number of NUMA nodes the workers were placed on
+    uint get_nodes_count() const { return _nnodes; }
+
+    ///Runtime statistics, collected only when compiled with COID_TASKMASTER_METRICS defined
+    struct metrics
+    {
+        struct priority {
+            uint64 tasks = 0;           //< number of tasks started
+            uint64 latency_ns = 0;      //< total time from push to start
+            uint64 max_latency_ns = 0;  //< maximum time from push to start
+
+            double avg_latency_ns() const { return tasks ? double(latency_ns) / tasks : 0.0; }
+        };
+
+        struct thread {
+            uint64 tasks = 0;           //< number of tasks run
+            uint64 busy_ns = 0;         //< time spent running tasks, including tasks run from wait()
+            uint64 idle_ns = 0;         //< time spent sleeping with no task to run (workers)
+            uint64 steals = 0;          //< number of tasks stolen from other workers
+            uint64 wait_help_ns = 0;    //< time spent in wait() running other tasks, overlaps busy_ns
+            uint64 wait_spin_ns = 0;    //< time spent in wait() yielding with no task to run
+
+            double utilization() const { return busy_ns + idle_ns ? double(busy_ns) / (busy_ns + idle_ns) : 0.0; }
+        };
+
+        priority prio[(int)EPriority::COUNT];
+        dynarray<thread> workers;
+        thread external;                //< sum for all non-worker threads
+    };
+
+    ///Get snapshot of runtime statistics since start or last reset_metrics()
+    //@return false if metrics weren't compiled in
+    bool get_metrics(metrics& m) const;
+
+    ///Reset runtime statistics
+    void reset_metrics();
+
+    ///Push runtime statistics accumulated since the last call to profiler counters
+    //@note meant to be called once per frame
+    void publish_metrics();
+
+    ///Automatic partitioning of parallel_for ranges
+    /// Range is split into chunks derived from the number of workers, chunks that get stolen by other
+    /// workers are split further to balance the load
+    struct auto_partitioner {};
+
+    ///Fixed partitioning of ranges in parallel algorithms
+    /// Range is split into chunks of given size regardless of the number of workers, so that
+    /// reductions and scans with non-associative operations (floating point) are reproducible
+    struct fixed_partitioner
+    {
+        uints grain;
+
+        explicit fixed_partitioner(uints grain) : grain(grain < 1 ? 1 : grain) {}
+    };
+
+    //@return priority of the task being run by the current thread, HIGH when not running a task
+    static EPriority current_priority() {
+        return running_priority();
+    }
+
     ///Run fn(index) in parallel in task level 0
     //@param first begin index value
     //@param last end index value
     //@param fn function(index) to run
+    //@param priority priority of the sub-range tasks, by default the priority of the calling task
+    //@note the range is split into sub-ranges using auto_partitioner, fn is invoked for each index
+    template <typename Index, typename Fn>
+    void parallel_for(Index first, Index last, const Fn& fn, EPriority priority = current_priority()) {
+        parallel_for(first, last, auto_partitioner(), [&fn](Index b, Index e) {
+            for (; b != e; ++b)
+                fn(b);
+        }, priority);
+    }
+
+    ///Run fn(begin, end) in parallel on sub-ranges of [first, last)
+    //@param first begin index value
+    //@param last end index value
+    //@param grain maximum size of the sub-range passed to fn, the range is split recursively until reaching it
+    //@param fn function(begin, end) to run
+    //@param priority priority of the sub-range tasks, by default the priority of the calling task
+    template <typename Index, typename Fn>
+    void parallel_for(Index first, Index last, uints grain, const Fn& fn, EPriority priority = current_priority()) {
+        if (!(first < last))
+            return;
+        if (grain < 1)
+            grain = 1;
+
+        run_range(first, last, grain, grain, fn, priority);
+    }
+
+    ///Run fn(begin, end) in parallel on sub-ranges of [first, last), partitioned automatically
+    //@param first begin index value
+    //@param last end index value
+    //@param fn function(begin, end) to run
+    //@param priority priority of the sub-range tasks, by default the priority of the calling task
     template <typename Index, typename Fn>
-    void parallel_for(Index first, Index last, const Fn& fn) {
-        signal_handle signal;
-        for (; first != last; ++first) {
-            push(EPriority::HIGH, &signal, fn, first);
+    void parallel_for(Index first, Index last, auto_partitioner, const Fn& fn, EPriority priority = current_priority()) {
+        if (!(first < last))
+            return;
+
+        //~8 chunks per thread, stolen chunks can be split 8x more
+        const uints n = uints(last - first);
+        const uints grain = n / (8 * (_threads.size() + 1)) + 1;
+
+        run_range(first, last, grain, grain / 8 + 1, fn, priority);
+    }
+
+    ///Parallel reduction of [first, last)
+    //@param identity initial value of the accumulators
+    //@param fn function(begin, end, T& acc) accumulating a sub-range into acc
+    //@param reduce function(T& acc, const T& value) merging partial results, must be associative
+    //@return reduced value
+    //@note partial results are merged in the order of sub-ranges, for a given number of workers
+    // the result is deterministic; use fixed_partitioner for results independent of the worker count
+    template <typename Index, typename T, typename Fn, typename Reduce>
+    T parallel_reduce(Index first, Index last, const T& identity, const Fn& fn, const Reduce& reduce) {
+        return parallel_reduce(first, last, default_partition(uints(last - first)), identity, fn, reduce);
+    }
+
+    ///Parallel reduction of [first, last) split into chunks of fixed size
+    template <typename Index, typename T, typename Fn, typename Reduce>
+    T parallel_reduce(Index first, Index last, fixed_partitioner part, const T& identity, const Fn& fn, const Reduce& reduce)
+    {
+        if (!(first < last))
+            return identity;
+
+        const uints n = uints(last - first);
+
+        dynarray<T> partial;
+        partial.alloc((n + part.grain - 1) / part.grain);
+        for (T& v : partial)
+            v = identity;
+
+        for_each_chunk(n, part.grain, [&](uints chunk, uints b, uints e) {
+            fn(Index(first + b), Index(first + e), partial[chunk]);
+        });
+
+        T result = identity;
+        for (const T& v : partial)
+            reduce(result, v);
+        return result;
+    }
+
+    ///Parallel reduction over dynarray or range elements, fn(T* begin, T* end, T& acc)
+    template <typename C, typename T, typename Fn, typename Reduce>
+    T parallel_reduce(C&& container, const T& identity, const Fn& fn, const Reduce& reduce) {
+        return parallel_reduce(container.begin(), container.end(), identity, fn, reduce);
+    }
+
+    template <typename C, typename T, typename Fn, typename Reduce>
+    T parallel_reduce(C&& container, fixed_partitioner part, const T& identity, const Fn& fn, const Reduce& reduce) {
+        return parallel_reduce(container.begin(), container.end(), part, identity, fn, reduce);
+    }
+
+    ///Parallel inclusive prefix scan, out[i] = op(...op(op(identity, in[0]), in[1])..., in[i])
+    //@param first,last input range (random access)
+    //@param out output iterator (random access), can be the same as first
+    //@param identity identity value of op
+    //@param op function(const T& a, const T& b) returning combined value, must be associative
+    //@note two passes over the input: chunk totals, then chunk scans starting from prefix of the totals
+    template <typename In, typename Out, typename T, typename Op>
+    void parallel_inclusive_scan(In first, In last, Out out, const T& identity, const Op& op) {
+        parallel_inclusive_scan(first, last, out, default_partition(uints(last - first)), identity, op);
+    }
+
+    ///Parallel inclusive prefix scan with chunks of fixed size
+    template <typename In, typename Out, typename T, typename Op>
+    void parallel_inclusive_scan(In first, In last, Out out, fixed_partitioner part, const T& identity, const Op& op)
+    {
+        if (!(first < last))
+            return;
+
+        const uints n = uints(last - first);
+
+        dynarray<T> partial;
+        partial.alloc((n + part.grain - 1) / part.grain);
+
+        for_each_chunk(n, part.grain, [&](uints chunk, uints b, uints e) {
+            T acc = identity;
+            for (In it = first + b, end = first + e; it != end; ++it)
+                acc = op(acc, *it);
+            partial[chunk] = std::move(acc);
+        });
+
+        //exclusive prefix of chunk totals, in order
+        T carry = identity;
+        for (T& v : partial) {
+            T sum = op(carry, v);
+            v = std::move(carry);
+            carry = std::move(sum);
         }
 
-        wait(signal);
+        for_each_chunk(n, part.grain, [&](uints chunk, uints b, uints e) {
+            T acc = partial[chunk];
+            Out o = out + b;
+            for (In it = first + b, end = first + e; it != end; ++it, ++o) {
+                acc = op(acc, *it);
+                *o = acc;
+            }
+        });
+    }
+
+    ///In-place parallel inclusive prefix scan of dynarray or range
+    template <typename C, typename T, typename Op>
+    void parallel_inclusive_scan(C&& container, const T& identity, const Op& op) {
+        parallel_inclusive_scan(container.begin(), container.end(), container.begin(), identity, op);
+    }
+
+    template <typename C, typename T, typename Op>
+    void parallel_inclusive_scan(C&& container, fixed_partitioner part, const T& identity, const Op& op) {
+        parallel_inclusive_scan(container.begin(), container.end(), container.begin(), part, identity, op);
+    }
+
+    ///Parallel stable merge sort
+    /// Chunks are sorted in parallel and then merged in parallel rounds, each merge split into
+    /// independent pieces. The result doesn't depend on the partitioning, the sort is stable.
+    //@param less comparator
+    template <typename T, typename Less>
+    void parallel_sort(T* first, T* last, const Less& less) {
+        parallel_sort(first, last, sort_partition(uints(last - first)), less);
+    }
+
+    template <typename T, typename Less>
+    void parallel_sort(T* first, T* last, fixed_partitioner part, const Less& less)
+    {
+        merge_sort(first, last, part.grain, [&less](T* b, T* e, T*) {
+            std::stable_sort(b, e, less);
+        }, less);
+    }
+
+    ///Parallel sort with default ordering, integers are sorted with radix sort of chunks
+    template <typename T>
+    void parallel_sort(T* first, T* last)
+    {
+        if constexpr (std::is_integral<T>::value && !std::is_same<T, bool>::value)
+            parallel_sort_by_key(first, last, radix_int_key<T>());
+        else
+            parallel_sort(first, last, std::less<T>());
+    }
+
+    ///Parallel stable sort by integer key, chunks are sorted using radixi and then merged in parallel
+    //@param key function(const T&) returning unsigned integer key
+    template <typename T, typename GetKey>
+    void parallel_sort_by_key(T* first, T* last, const GetKey& key)
+    {
+        using key_t = std::decay_t<decltype(key(*first))>;
+        static_assert(std::is_unsigned<key_t>::value, "key must be an unsigned integer");
+
+        merge_sort(first, last, sort_partition(uints(last - first)).grain, [&key](T* b, T* e, T* tmp) {
+            const uints n = uints(e - b);
+            radixi<T, uints, key_t, GetKey> rx(key);
+            const uints* idx = rx.sort(true, b, n);
+
+            for (uints i = 0; i < n; ++i)
+                tmp[i] = std::move(b[idx[i]]);
+            std::move(tmp, tmp + n, b);
+        }, [&key](const T& a, const T& b) {
+            return key(a) < key(b);
+        });
+    }
+
+    ///Parallel sort of dynarray or range
+    template <typename C>
+    void parallel_sort(C&& container) {
+        parallel_sort(container.begin(), container.end());
+    }
+
+    template <typename C, typename Less>
+    void parallel_sort(C&& container, const Less& less) {
+        parallel_sort(container.begin(), container.end(), less);
     }
 
     ///Push task (functor, e.g. lamda) into queue for processing by worker threads
@@ -168,19 +535,62 @@ public:
     {
         using callfn = invoker<Fn, Args...>;
 
-        {
-            //lock to access allocator and semaphore
-            std::unique_lock<std::mutex> lock(_sync);
+        void* p = alloc_data(sizeof(callfn));
+        increment(signal);
+        auto task = new(p) callfn(signal ? *signal : invalid_signal, fn, std::forward<Args>(args)...);
+
+        push_task(task, priority);
+    }
+
+    ///Push task (function and its arguments) that will be queued once all predecessor signals are signaled
+    //@param deps predecessor signals, invalid or already signaled ones are ignored
+    //@param ndeps number of predecessor signals
+    //@param priority task priority, higher priority tasks are processed before lower priority
+    //@param signal signal to trigger when the task finishes, incremented immediately
+    //@param fn function to run
+    //@param args arguments needed to invoke the function
+    template <typename Fn, typename ...Args>
+    void push_after(const signal_handle* deps, uint ndeps, EPriority priority, signal_handle* signal, const Fn& fn, Args&& ...args)
+    {
+        using callfn = invoker<Fn, Args...>;
 
-            granule* p = alloc_data(sizeof(callfn));
-            increment(signal);
-            auto task = new(p) callfn(signal ? *signal : invalid_signal, fn, std::forward<Args>(args)...);
+        const uints offs = align_to_chunks(sizeof(callfn), sizeof(void*)) * sizeof(void*);
+        const uints extra = sizeof(deferred) + ndeps * sizeof(continuation);
 
-            _ready_jobs[(int)priority].push_front(task);
+        void* p = alloc_data(offs + extra);
+        increment(signal);
+        auto task = new(p) callfn(signal ? *signal : invalid_signal, fn, std::forward<Args>(args)...);
+        task->_extra = uint(offs + extra - sizeof(callfn));
 
-            ++_qsize;
+        deferred* def = new((uint8*)p + offs) deferred;
+        def->task = task;
+        def->priority = priority;
+        //+1 keeps the task from being queued until all links are added
+        def->npending.store(ndeps + 1, std::memory_order_relaxed);
+
+        continuation* links = reinterpret_cast<continuation*>(def + 1);
+        uint nsatisfied = 1;
+
+        for (uint i = 0; i < ndeps; ++i) {
+            links[i].owner = def;
+            if (!deps[i].is_valid() || !add_continuation(deps[i], links + i))
+                ++nsatisfied;
         }
-        _cv.notify_one();
+
+        if (def->npending.fetch_sub(nsatisfied, std::memory_order_acq_rel) == int(nsatisfied))
+            push_task(task, priority);
+    }
+
+    ///Push task (function and its arguments) that will be queued once the predecessor signal is signaled
+    //@param after predecessor signal
+    //@param priority task priority, higher priority tasks are processed before lower priority
+    //@param signal signal to trigger when the task finishes, incremented immediately
+    //@param fn function to run
+    //@param args arguments needed to invoke the function
+    template <typename Fn, typename ...Args>
+    void then(signal_handle after, EPriority priority, signal_handle* signal, const Fn& fn, Args&& ...args)
+    {
+        push_after(&after, 1, priority, signal, fn, std::forward<Args>(args)...);
     }
 
     ///Push task (function and its arguments) into queue for processing by worker threads
@@ -196,19 +606,11 @@ public:
 
         using callfn = invoker_memberfn<Fn, C*, Args...>;
 
-        {
-            //lock to access allocator and semaphore
-            std::unique_lock<std::mutex> lock(_sync);
-
-            granule* p = alloc_data(sizeof(callfn));
-            increment(signal);
-            auto task = new(p) callfn(signal ? *signal : invalid_signal, fn, obj, std::forward<Args>(args)...);
+        void* p = alloc_data(sizeof(callfn));
+        increment(signal);
+        auto task = new(p) callfn(signal ? *signal : invalid_signal, fn, obj, std::forward<Args>(args)...);
 
-            _ready_jobs[(int)priority].push_front(task);
-
-            ++_qsize;
-        }
-        _cv.notify_one();
+        push_task(task, priority);
     }
 
     ///Push task (function and its arguments) into queue for processing by worker threads
@@ -224,19 +626,94 @@ public:
 
         using callfn = invoker_memberfn<Fn, C, Args...>;
 
-        {
-            //lock to access allocator and semaphore
-            std::unique_lock<std::mutex> lock(_sync);
+        void* p = alloc_data(sizeof(callfn));
+        increment(signal);
+        auto task = new(p) callfn(signal ? *signal : invalid_signal, fn, obj, std::forward<Args>(args)...);
+
+        push_task(task, priority);
+    }
+
+    ///Push task (function and its arguments) with a target completion time
+    /// Deadline tasks of given priority are served before the regular tasks of the same priority,
+    /// earliest deadline first. After half of the time remaining to the deadline elapses (but not
+    /// later than the deadline window before it, see set_deadline_window), the task becomes urgent:
+    /// it's run before any regular task, and by any worker regardless of the priority restrictions
+    //@param deadline_ns target completion time, in nsec_timer::current_time_ns() time base
+    //@param priority task priority, higher priority tasks are processed before lower priority
+    //@param signal signal to trigger when the task finishes
+    //@param fn function to run
+    //@param args arguments needed to invoke the function
+    template <typename Fn, typename ...Args>
+    void push_deadline(uint64 deadline_ns, EPriority priority, signal_handle* signal, const Fn& fn, Args&& ...args)
+    {
+        push_deadline(deadline_ns, deadline_lead(deadline_ns), priority, signal, fn, std::forward<Args>(args)...);
+    }
+
+    ///Push task (function and its arguments) with a target completion time and explicit lead time
+    //@param deadline_ns target completion time, in nsec_timer::current_time_ns() time base
+    //@param lead_ns time before the deadline when the task becomes urgent, e.g. the expected run time of the task
+    //@param priority task priority, higher priority tasks are processed before lower priority
+    //@param signal signal to trigger when the task finishes
+    //@param fn function to run
+    //@param args arguments needed to invoke the function
+    template <typename Fn, typename ...Args>
+    void push_deadline(uint64 deadline_ns, uint64 lead_ns, EPriority priority, signal_handle* signal, const Fn& fn, Args&& ...args)
+    {
+        using callfn = invoker<Fn, Args...>;
 
-            granule* p = alloc_data(sizeof(callfn));
-            increment(signal);
-            auto task = new(p) callfn(signal ? *signal : invalid_signal, fn, obj, std::forward<Args>(args)...);
+        void* p = alloc_data(sizeof(callfn));
+        increment(signal);
+        auto task = new(p) callfn(signal ? *signal : invalid_signal, fn, std::forward<Args>(args)...);
 
-            _ready_jobs[(int)priority].push_front(task);
+        push_deadline_task(task, priority, deadline_ns, deadline_ns > lead_ns ? deadline_ns - lead_ns : 0);
+    }
 
-            ++_qsize;
-        }
-        _cv.notify_one();
+    ///Set the minimum lead time before their deadline when the deadline tasks pushed without explicit lead become urgent
+    //@param window_ns time in ns, default 2ms
+    void set_deadline_window(uint64 window_ns) { _deadline_window = window_ns; }
+
+    uint64 get_deadline_window() const { return _deadline_window; }
+
+    ///Push a batch of tasks, one per index in [0, count), invoking fn(index)
+    /// All tasks are queued at once and at most count sleeping workers are woken up, which is much
+    /// cheaper than pushing the tasks one by one
+    //@param priority task priority, higher priority tasks are processed before lower priority
+    //@param signal signal to trigger when all the tasks finish
+    //@param count number of tasks
+    //@param fn functor to run, fn(uints index)
+    template <typename Fn>
+    void push_many(EPriority priority, signal_handle* signal, uints count, const Fn& fn)
+    {
+        auto call = [](const Fn& fn, uints index) {
+            fn(index);
+        };
+        using callfn = invoker<decltype(call), const Fn&, uints>;
+
+        push_batch(priority, signal, count, [&](signal_handle handle, uints index) {
+            void* p = alloc_data(sizeof(callfn));
+            return static_cast<invoker_base*>(new(p) callfn(handle, call, fn, uints(index)));
+        });
+    }
+
+    ///Push a batch of tasks, one per item in range [first, last), invoking fn(*it)
+    /// All tasks are queued at once and at most as many sleeping workers as there are items are woken up
+    //@param priority task priority, higher priority tasks are processed before lower priority
+    //@param signal signal to trigger when all the tasks finish
+    //@param first,last range of items, the items must stay valid until the tasks finish
+    //@param fn functor to run, fn(item)
+    template <typename It, typename Fn>
+    void push_range(EPriority priority, signal_handle* signal, It first, It last, const Fn& fn)
+    {
+        auto call = [](const Fn& fn, const It& it) {
+            fn(*it);
+        };
+        using callfn = invoker<decltype(call), const Fn&, It>;
+
+        It it = first;
+        push_batch(priority, signal, uints(std::distance(first, last)), [&](signal_handle handle, uints) {
+            void* p = alloc_data(sizeof(callfn));
+            return static_cast<invoker_base*>(new(p) callfn(handle, call, fn, It(it++)));
+        });
     }
 
     /// Enter critical section; no two threads can be in the same critical section at the same time
@@ -246,25 +723,30 @@ public:
     // deadlock thanks to taskmaster's nature
     void enter_critical_section(critical_section& critical_section, int spin_count = 1024)
     {
+        backoff idle;
+
         for (;;) {
             for (int i = 0; i < spin_count; ++i) {
                 if (critical_section.value == 0 && atomic::cas(&critical_section.value, 1, 0) == 0) {
+                    flush_heap();
                     return;
                 }
+                atomic::cpu_pause();
             }
 
-            invoker_base* task = 0;
             const int order = get_order();
-            for (int prio = 0; prio < (int)EPriority::COUNT; ++prio) {
-                const bool can_run = prio != (int)EPriority::LOW || (order < _nlowprio_threads&& order != -1);
-                if (can_run && _ready_jobs[prio].pop(task)) {
-                    --_qsize;
-                    run_task(task, get_order());
-                    break;
-                }
+            invoker_base* task = pop_task(order);
+            if (task) {
+                run_task(task, order);
+                idle.reset();
+            }
+            else if (idle.next() && !has_task(order)) {
+                //park until the section is released
+                critical_section.nwaiters.fetch_add(1, std::memory_order_seq_cst);
+                if (critical_section.value != 0)
+                    atomic::futex_wait(&critical_section.value, 1, PARK_TIMEOUT_MS);
+                critical_section.nwaiters.fetch_sub(1, std::memory_order_relaxed);
             }
-            if (!task)
-                thread::wait(0);
         }
     }
 
@@ -275,6 +757,9 @@ public:
     {
         const int32 prev = atomic::cas(&critical_section.value, 0, 1);
         DASSERTN(prev == 1);
+
+        if (critical_section.nwaiters.load(std::memory_order_seq_cst) > 0)
+            atomic::futex_wake_one(&critical_section.value);
     }
 
 
@@ -283,24 +768,38 @@ public:
     //@note each time a task is pushed to queue and has a signal associated, it increments the signal's counter.
     // When the task finishes it decrements the counter. Once the counter == 0, the signal is in signaled state.
     // Multiple tasks can use the same signal.
+    //@note while waiting the thread runs other tasks; when there are none it spins briefly, then yields
+    // and finally parks until the signal is triggered
     void wait(signal_handle signal)
     {
         if (!signal.is_valid()) return;
 
         const int order = get_order();
-        while (!is_signaled(signal, true)) {
-            invoker_base* task = 0;
-            for (int prio = 0; prio < (int)EPriority::COUNT; ++prio) {
-                const bool can_run = prio != (int)EPriority::LOW || (order < _nlowprio_threads&& order != -1);
-                if (can_run && _ready_jobs[prio].pop(task)) {
-                    --_qsize;
-                    run_task(task, get_order());
-                    break;
-                }
+
+#ifdef COID_TASKMASTER_METRICS
+        metrics_block& stats = local_stats(order);
+        uint64 t0 = metrics_time();
+#endif
+
+        backoff idle;
+
+        while (!is_signaled(signal)) {
+            invoker_base* task = pop_task(order);
+            if (task) {
+                run_task(task, order);
+                idle.reset();
             }
-            if (!task)
-                thread::wait(0);
+            else if (idle.next() && !has_task(order))
+                park(signal);
+
+#ifdef COID_TASKMASTER_METRICS
+            const uint64 t1 = metrics_time();
+            stats.add(task ? stats.wait_help_ns : stats.wait_spin_ns, t1 - t0);
+            t0 = t1;
+#endif
         }
+
+        flush_heap();
     }
 
     ///Terminate all task threads
@@ -308,13 +807,22 @@ public:
     void terminate(bool empty_queue)
     {
         if (empty_queue) {
-            while (_qsize > 0)
+            while (queue_size() > 0)
                 thread::wait(0);
         }
 
         _quitting = true;
 
-        notify((int)_threads.size());
+        if (_mode == EScheduling::WORK_STEALING) {
+            std::unique_lock<std::mutex> lock(_sync);
+            _cv.notify_all();
+        }
+        else
+            notify((int)_threads.size());
+
+        //threads that haven't started yet aren't registered and join wouldn't wait for them
+        while (_nstarted < (int)_threads.size())
+            thread::wait(0);
 
         //wait for cancellation
         _threads.for_each([](threadinfo& ti) {
@@ -329,46 +837,50 @@ public:
     // if you just want to wait until some task finishes, you do not need to use this, see "Basic usage"
     signal_handle create_signal()
     {
-        std::unique_lock<std::mutex> lock(_signal_sync);
-
-        signal_handle handle;
-        if (!_free_signals.pop(handle)) return invalid_signal;
-
-        signal& s = _signal_pool[handle.index()];
-        s.ref = 1;
-
-        return handle;
+        return alloc_signal();
     }
 
     ///Manually decrements signal's counter. When the counter reaches 0, the signal is in signaled state
     ///and waiting entities can progress further.
     void trigger_signal(signal_handle handle)
     {
-        std::unique_lock<std::mutex> lock(_signal_sync);
-
-        signal& s = _signal_pool[handle.index()];
-        --s.ref;
-        if (s.ref == 0) {
-            s.version = (s.version + 1) % 0xffFF;
-            signal_handle free_handle = signal_handle::make(s.version, handle.index());
-            _free_signals.push(free_handle);
-        }
+        release_signal(handle);
     }
 
-protected:
+    //@return true if the signal is signaled (its counter reached 0)
+    bool is_signaled(signal_handle handle) const
+    {
+        DASSERT_RET(handle.is_valid(), false);
 
-    ///
-    struct threadinfo
+        const uint64 state = get_signal(handle.index()).state.load(std::memory_order_acquire);
+
+        return signal::version(state) != handle.version() || signal::ref(state) == 0;
+    }
+
+    ///Cancel tasks associated with the signal
+    /// Queued tasks of the signal, including those pushed after the cancellation until the signal
+    /// gets signaled, are skipped without running their body. The signal is still decremented
+    /// by each skipped task, so wait(signal) returns once the running ones finish.
+    //@return false if the signal was already signaled
+    bool cancel(signal_handle handle)
     {
-        thread tid;
-        taskmaster* master;
+        if (!handle.is_valid() || is_signaled(handle))
+            return false;
 
-        int order;
+        get_signal(handle.index()).cancelled.store(handle.version(), std::memory_order_release);
+        return true;
+    }
 
+    //@return true if the signal was cancelled, for running tasks to stop early
+    bool is_cancelled(signal_handle handle) const
+    {
+        return handle.is_valid()
+            && get_signal(handle.index()).cancelled.load(std::memory_order_acquire) == handle.version();
+    }
 
-        threadinfo() : master(0), order(-1)
-        {}
-    };
+protected:
+
+    struct invoker_base;
 
     ///Unit of allocation for tasks
     struct granule
@@ -376,72 +888,406 @@ protected:
         uint8 dummy[8 * sizeof(void*)];
     };
 
-    static int& get_order()
-    {
-        static thread_local int order = -1;
-        return order;
-    }
+    enum {
+        NSIZE_CLASSES = 5,              //< per-thread heap block sizes 1,2,4,8,16 granules
+        SLAB_BLOCKS = 64,               //< blocks allocated at once per size class
+        REMOTE_BATCH = 32,              //< max blocks batched before returning them to owner heap
+    };
+
+    struct task_heap;
 
-    granule* alloc_data(uints size)
+    ///Header preceding each allocated task block
+    struct block_header
     {
-        uints n = align_to_chunks(size, sizeof(granule));
-        granule* p = _taskdata.add_contiguous_range_uninit(n);
+        task_heap* heap;                //< owner heap, nullptr if allocated from the shared pool
+        uint32 sclass;                  //< size class in the owner heap
+        uint32 ngranules;               //< number of granules allocated from the shared pool
+    };
 
-        //coidlog_devdbg("taskmaster", "pushed task id " << _taskdata.get_item_id(p));
-        return p;
-    }
+    ///Per-thread allocator of task blocks
+    /// Blocks are allocated and freed without locking by the owner thread, blocks freed by other
+    /// threads are batched and returned to owner's remote list, which it takes over when it runs dry
+    struct task_heap
+    {
+        struct free_block {
+            free_block* next;
+        };
 
-    ///
-    struct invoker_base {
-        virtual void invoke() = 0;
-        virtual size_t size() const = 0;
+        thread_t owner;                 //< invalid if the owner thread exited, the heap can be adopted by another thread
+        taskmaster* master = 0;         //< taskmaster of a non-worker thread heap, nullptr once it's destroyed
 
-        invoker_base(signal_handle signal)
-            : _signal(signal)
-            , _tid(thread::self())
-        {}
+        free_block* local[NSIZE_CLASSES];
 
-        signal_handle signal() const {
-            return _signal;
-        }
+        //batch of blocks freed by this thread but owned by another heap
+        task_heap* batch_heap;
+        uint batch_class;
+        uint batch_count;
+        free_block* batch_head;
+        free_block* batch_tail;
 
-    protected:
-        signal_handle _signal;
-        thread_t _tid;
-    };
+        dynarray<void*> slabs;
 
-    template <typename Fn, typename ...Args>
-    struct invoker_common : invoker_base
-    {
-        invoker_common(signal_handle signal, const Fn& fn, Args&& ...args)
-            : invoker_base(signal)
-            , _fn(fn)
-            , _tuple(std::forward<Args>(args)...)
-        {}
+        //blocks returned by other threads
+        alignas(64) std::atomic<free_block*> remote[NSIZE_CLASSES];
 
-    protected:
 
-        template <size_t ...I>
-        void invoke_fn(index_sequence<I...>) {
-            _fn(std::get<I>(_tuple)...);
+        task_heap() : owner(thread::invalid()), batch_heap(0), batch_class(0), batch_count(0), batch_head(0), batch_tail(0)
+        {
+            for (int i = 0; i < NSIZE_CLASSES; ++i) {
+                local[i] = 0;
+                remote[i] = 0;
+            }
         }
 
-        template <class C, size_t ...I>
-        void invoke_memberfn(C& obj, index_sequence<I...>) {
-            (obj.*_fn)(std::get<I>(_tuple)...);
+        ~task_heap();
+
+        block_header* alloc(uint sclass)
+        {
+            free_block* b = local[sclass];
+            if (!b)
+                b = refill(sclass);
+            local[sclass] = b->next;
+
+            block_header* h = reinterpret_cast<block_header*>(b);
+            h->heap = this;
+            h->sclass = sclass;
+            return h;
         }
 
-    private:
+        void free(block_header* h)
+        {
+            const uint sclass = h->sclass;
+            free_block* b = reinterpret_cast<free_block*>(h);
 
-        typedef std::tuple<std::remove_reference_t<Args>...> tuple_t;
+            if (h->heap == this) {
+                b->next = local[sclass];
+                local[sclass] = b;
+                return;
+            }
 
-        Fn _fn;
-        tuple_t _tuple;
-    };
+            if (batch_heap != h->heap || batch_class != sclass)
+                flush();
 
-    ///invoker for lambdas and functions
-    template <typename Fn, typename ...Args>
-    struct invoker : invoker_common<Fn, Args...>
+            if (!batch_head) {
+                batch_heap = h->heap;
+                batch_class = sclass;
+                batch_tail = b;
+            }
+            b->next = batch_head;
+            batch_head = b;
+
+            if (++batch_count >= REMOTE_BATCH)
+                flush();
+        }
+
+        ///Return batched blocks to their owner heap
+        void flush();
+
+    private:
+        free_block* refill(uint sclass);
+    };
+
+    ///Queue of deadline tasks of one priority, ordered by the time they become urgent
+    /// with the default lead time proportional to the budget it's the same order as by deadline
+    struct deadline_queue
+    {
+        struct entry {
+            uint64 urgent;                          //< time when the task becomes urgent
+            uint64 deadline;
+            invoker_base* task;
+
+            bool operator < (const entry& other) const {
+                return urgent != other.urgent ? urgent > other.urgent : deadline > other.deadline;
+            }
+        };
+
+        std::mutex sync;
+        dynarray<entry> heap;                       //< max-heap on reversed compare, earliest urgency on top
+        std::atomic<uint64> earliest = {UINT64_MAX};  //< urgency time of the top task, for checks without locking
+        std::atomic_int count = {0};
+
+        void push(invoker_base* task, uint64 deadline, uint64 urgent)
+        {
+            std::unique_lock<std::mutex> lock(sync);
+
+            entry* e = heap.add();
+            e->urgent = urgent;
+            e->deadline = deadline;
+            e->task = task;
+            std::push_heap(heap.ptr(), heap.ptre());
+
+            earliest.store(heap[0].urgent, std::memory_order_relaxed);
+            ++count;
+        }
+
+        ///Pop task with the earliest urgency time, if not later than max_urgent
+        bool pop(invoker_base*& task, uint64 max_urgent)
+        {
+            if (count <= 0 || earliest.load(std::memory_order_relaxed) > max_urgent)
+                return false;
+
+            std::unique_lock<std::mutex> lock(sync);
+
+            if (heap.size() == 0 || heap[0].urgent > max_urgent)
+                return false;
+
+            task = heap[0].task;
+            std::pop_heap(heap.ptr(), heap.ptre());
+            heap.resize(heap.size() - 1);
+
+            earliest.store(heap.size() ? heap[0].urgent : UINT64_MAX, std::memory_order_relaxed);
+            --count;
+            return true;
+        }
+    };
+
+#ifdef COID_TASKMASTER_METRICS
+    static uint64 metrics_time() { return nsec_timer::current_time_ns(); }
+
+    ///Statistics counters of a thread
+    /// Worker counters are updated only by the owning worker without atomic RMW operations,
+    /// counters of non-worker threads are shared
+    struct alignas(64) metrics_block
+    {
+        enum { NCOUNTERS = 6 + 3 * (int)EPriority::COUNT };
+
+        bool shared = false;
+
+        std::atomic<uint64> tasks, busy_ns, idle_ns, steals, wait_help_ns, wait_spin_ns;
+        std::atomic<uint64> prio_tasks[(int)EPriority::COUNT];
+        std::atomic<uint64> prio_latency_ns[(int)EPriority::COUNT];
+        std::atomic<uint64> prio_max_latency_ns[(int)EPriority::COUNT];
+
+        metrics_block() { reset(); }
+
+        void reset() {
+            tasks = busy_ns = idle_ns = steals = wait_help_ns = wait_spin_ns = 0;
+            for (int i = 0; i < (int)EPriority::COUNT; ++i)
+                prio_tasks[i] = prio_latency_ns[i] = prio_max_latency_ns[i] = 0;
+        }
+
+        void add(std::atomic<uint64>& c, uint64 v) {
+            if (shared)
+                c.fetch_add(v, std::memory_order_relaxed);
+            else
+                c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+        }
+
+        void add_latency(int prio, uint64 ns) {
+            add(prio_tasks[prio], 1);
+            add(prio_latency_ns[prio], ns);
+
+            uint64 cur = prio_max_latency_ns[prio].load(std::memory_order_relaxed);
+            while (ns > cur && !prio_max_latency_ns[prio].compare_exchange_weak(cur, ns, std::memory_order_relaxed));
+        }
+    };
+#endif
+
+    ///
+    struct threadinfo
+    {
+        thread tid;
+        taskmaster* master;
+
+        int order;
+
+        ///per-priority task deques used in WORK_STEALING mode
+        atomic::ws_deque<invoker_base*> deque[(int)EPriority::COUNT];
+
+        task_heap heap;
+
+        cpuset cpus;                    //< cpus the thread is pinned to, empty if not pinned
+        uint node;                      //< NUMA node of the thread
+
+#ifdef COID_TASKMASTER_METRICS
+        metrics_block stats;
+#endif
+
+
+        threadinfo() : master(0), order(-1), node(0)
+        {}
+    };
+
+    static int& get_order()
+    {
+        static thread_local int order = -1;
+        return order;
+    }
+
+    ///Priority of the task being run by the current thread
+    static EPriority& running_priority()
+    {
+        static thread_local EPriority prio = EPriority::HIGH;
+        return prio;
+    }
+
+    //@return taskmaster owning current worker thread, or nullptr if not a worker thread
+    static taskmaster*& get_master()
+    {
+        static thread_local taskmaster* master = 0;
+        return master;
+    }
+
+    //@return true if task of given priority can be run by thread with given order
+    bool can_run(int prio, int order) const {
+        return prio != (int)EPriority::LOW || (order < _nlowprio_threads && order != -1);
+    }
+
+    static constexpr uint size_class(uints ngranules) {
+        return ngranules <= 1 ? 0
+            : ngranules <= 2 ? 1
+            : ngranules <= 4 ? 2
+            : ngranules <= 8 ? 3
+            : ngranules <= 16 ? 4
+            : NSIZE_CLASSES;
+    }
+
+    ///Allocate memory for task invoker and its extra data
+    /// Small tasks (up to 1kB) are allocated from the current thread's heap without locking,
+    /// larger ones from the shared pool
+    void* alloc_data(uints size)
+    {
+        const uints n = align_to_chunks(size + sizeof(block_header), sizeof(granule));
+        const uint sclass = size_class(n);
+
+        block_header* h;
+        if (sclass < NSIZE_CLASSES) {
+            h = local_heap()->alloc(sclass);
+        }
+        else {
+            //lock to access allocator
+            std::unique_lock<std::mutex> lock(_alloc_sync);
+
+            h = reinterpret_cast<block_header*>(_taskdata.add_contiguous_range_uninit(n));
+            h->heap = 0;
+            h->ngranules = uint32(n);
+        }
+
+        return h + 1;
+    }
+
+    void free_data(invoker_base* task)
+    {
+        block_header* h = reinterpret_cast<block_header*>(task) - 1;
+
+        if (h->heap)
+            local_heap()->free(h);
+        else
+            _taskdata.del_range(reinterpret_cast<granule*>(h), h->ngranules);
+    }
+
+    //@return task heap of the current thread
+    task_heap* local_heap()
+    {
+        struct cache {
+            uint64 serial;
+            task_heap* heap;
+        };
+        static thread_local cache c = { 0, 0 };
+
+        if (c.serial != _serial) {
+            c.heap = find_heap();
+            c.serial = _serial;
+        }
+        return c.heap;
+    }
+
+    task_heap* find_heap();
+
+    ///Heaps of a non-worker thread, released at thread exit
+    struct thread_heaps;
+
+    ///Orphan heaps of an exiting non-worker thread, so that their blocks are reused by other threads
+    static void release_heaps(dynarray<task_heap*>& heaps);
+
+    //@return mutex guarding the hand-over of non-worker heaps between exiting threads and taskmaster destruction
+    static std::mutex& heap_sync();
+
+    ///Return blocks freed by current thread to their owner heaps
+    void flush_heap() {
+        local_heap()->flush();
+    }
+
+    ///
+    struct invoker_base {
+        virtual void invoke() = 0;
+        virtual size_t size() const = 0;
+
+        invoker_base(signal_handle signal)
+            : _signal(signal)
+            , _tid(thread::self())
+        {}
+
+        signal_handle signal() const {
+            return _signal;
+        }
+
+        //@return size of extra data allocated after the invoker
+        uint extra_size() const {
+            return _extra;
+        }
+
+    protected:
+        friend class taskmaster;
+
+        signal_handle _signal;
+        uint _extra = 0;
+        thread_t _tid;
+        uint32 _link = 0;               //< profiler link between push and run, 0 if not profiled
+        int _prio = 0;
+
+#ifdef COID_TASKMASTER_METRICS
+        uint64 _pushed_ns = 0;
+#endif
+    };
+
+    ///Task waiting for predecessor signals, stored after the invoker
+    struct deferred
+    {
+        invoker_base* task;
+        std::atomic_int npending;       //< number of predecessors not signaled yet
+        EPriority priority;
+    };
+
+    ///Link of a deferred task in a signal's continuation list
+    struct continuation
+    {
+        deferred* owner;
+        continuation* next;
+    };
+
+    template <typename Fn, typename ...Args>
+    struct invoker_common : invoker_base
+    {
+        invoker_common(signal_handle signal, const Fn& fn, Args&& ...args)
+            : invoker_base(signal)
+            , _fn(fn)
+            , _tuple(std::forward<Args>(args)...)
+        {}
+
+    protected:
+
+        template <size_t ...I>
+        void invoke_fn(index_sequence<I...>) {
+            _fn(std::get<I>(_tuple)...);
+        }
+
+        template <class C, size_t ...I>
+        void invoke_memberfn(C& obj, index_sequence<I...>) {
+            (obj.*_fn)(std::get<I>(_tuple)...);
+        }
+
+    private:
+
+        typedef std::tuple<std::remove_reference_t<Args>...> tuple_t;
+
+        Fn _fn;
+        tuple_t _tuple;
+    };
+
+    ///invoker for lambdas and functions
+    template <typename Fn, typename ...Args>
+    struct invoker : invoker_common<Fn, Args...>
     {
         invoker(signal_handle signal, const Fn& fn, Args&& ...args)
             : invoker_common<Fn, Args...>(signal, fn, std::forward<Args>(args)...)
@@ -527,10 +1373,30 @@ protected:
         iref<C> _obj;
     };
 
+    ///Signal state, counter and version packed in a single word so that both can be updated atomically
     struct signal
     {
-        volatile int ref;
-        uint32 version;
+        static const uint64 ref_mask = 0xffffffffULL;
+        static const int version_shift = 32;
+
+        std::atomic<uint64> state;      //< version << version_shift | ref
+        std::atomic<uint32> next_free;  //< next free signal index + 1, valid in the free list only
+        std::atomic<continuation*> continuations; //< tasks waiting for this signal
+        std::atomic<uint32> epoch;      //< incremented each time the signal is triggered, parked threads wait on it
+        std::atomic<uint32> nwaiters;   //< number of threads parked on epoch
+        std::atomic<uint32> cancelled;  //< version of the signal that was cancelled, or no_version
+
+        static uint version(uint64 state) { return uint(state >> version_shift); }
+        static uint ref(uint64 state) { return uint(state & ref_mask); }
+        static uint64 make(uint version, uint ref) { return (uint64(version) << version_shift) | ref; }
+
+        static const uint32 no_version = 0xffFFffFF;
+    };
+
+    enum {
+        SIGNAL_PAGE_SHIFT = 12,
+        SIGNAL_PAGE_SIZE = 1 << SIGNAL_PAGE_SHIFT,
+        MAX_SIGNAL_PAGES = (signal_handle::index_mask + 1) / SIGNAL_PAGE_SIZE,
     };
 
 private:
@@ -544,81 +1410,773 @@ private:
 
     void* threadfunc(int order);
 
-    void run_task(invoker_base* task, int order)
+    ///Assign cpus to worker threads according to placement policy
+    void place_threads(EPlacement placement);
+
+    ///Split range and wait for all sub-ranges to finish
+    template <typename Index, typename Fn>
+    void run_range(Index first, Index last, uints grain, uints min_grain, const Fn& fn, EPriority priority)
+    {
+        //hold the signal while splitting, sub-ranges increment it
+        signal_handle signal = create_signal();
+        if (!signal.is_valid()) {
+            fn(first, last);
+            return;
+        }
+
+        split_range(signal, first, last, grain, min_grain, fn, priority);
+
+        trigger_signal(signal);
+        wait(signal);
+    }
+
+    ///Run fn(chunk, begin, end) in parallel for chunks of given size covering [0, n)
+    template <typename Fn>
+    void for_each_chunk(uints n, uints grain, const Fn& fn)
+    {
+        const uints nchunks = (n + grain - 1) / grain;
+
+        parallel_for(uints(0), nchunks, uints(1), [&](uints cb, uints ce) {
+            for (; cb < ce; ++cb) {
+                const uints b = cb * grain;
+                fn(cb, b, b + grain < n ? b + grain : n);
+            }
+        });
+    }
+
+    ///Chunks for parallel reductions and scans, a few per worker
+    fixed_partitioner default_partition(uints n) const {
+        return fixed_partitioner(n / (4 * (_threads.size() + 1)) + 1);
+    }
+
+    ///Chunks for parallel sort, a couple per worker but not too small
+    fixed_partitioner sort_partition(uints n) const {
+        const uints grain = n / (2 * (_threads.size() + 1)) + 1;
+        return fixed_partitioner(grain < 2048 ? 2048 : grain);
+    }
+
+    ///Radix key of an integer type, signed values with flipped sign bit
+    template <typename T>
+    struct radix_int_key
+    {
+        using U = std::make_unsigned_t<T>;
+
+        U operator()(const T& v) const {
+            return std::is_signed<T>::value ? U(U(v) ^ (U(1) << (sizeof(T) * 8 - 1))) : U(v);
+        }
+    };
+
+    //@return number of elements of sorted run a that precede the first k elements of merge of a and b
+    template <typename T, typename Less>
+    static uints merge_split(const T* a, uints na, const T* b, uints nb, uints k, const Less& less)
+    {
+        uints lo = k > nb ? k - nb : 0;
+        uints hi = k < na ? k : na;
+
+        //first i where a[i] doesn't precede b[k-i-1]; equal elements of a go first
+        while (lo < hi) {
+            const uints i = (lo + hi) / 2;
+            if (!less(b[k - i - 1], a[i]))
+                lo = i + 1;
+            else
+                hi = i;
+        }
+        return lo;
+    }
+
+    ///Sort chunks with sort_chunk(begin, end, tmp), then merge runs in rounds
+    /// Each merge is split into output pieces of grain size that are merged independently
+    template <typename T, typename SortChunk, typename Less>
+    void merge_sort(T* first, T* last, uints grain, const SortChunk& sort_chunk, const Less& less)
     {
-        uints id = _taskdata.get_item_id((granule*)task);
-        //coidlog_devdbg("taskmaster", "thread " << order << " processing task id " << id);
+        const uints n = uints(last - first);
+        if (n < 2)
+            return;
+
+        dynarray<T> buf;
+        T* src = first;
+        T* dst = buf.alloc(n);
+
+        for_each_chunk(n, grain, [&](uints, uints b, uints e) {
+            sort_chunk(first + b, first + e, dst + b);
+        });
+
+        for (uints width = grain; width < n; width *= 2) {
+            for_each_chunk(n, grain, [&](uints, uints o0, uints o1) {
+                //pieces don't cross pairs since 2*width is a multiple of grain
+                const uints base = o0 - o0 % (2 * width);
+                const T* a = src + base;
+                const uints na = width < n - base ? width : n - base;
+                const T* b = a + na;
+                const uints nb = n - base - na < width ? n - base - na : width;
+
+                const uints i0 = merge_split(a, na, b, nb, o0 - base, less);
+                const uints i1 = merge_split(a, na, b, nb, o1 - base, less);
+                const uints j0 = o0 - base - i0;
+                const uints j1 = o1 - base - i1;
+
+                std::merge(
+                    std::make_move_iterator(src + base + i0), std::make_move_iterator(src + base + i1),
+                    std::make_move_iterator(src + base + na + j0), std::make_move_iterator(src + base + na + j1),
+                    dst + o0, less);
+            });
+            std::swap(src, dst);
+        }
 
+        if (src != first) {
+            for_each_chunk(n, grain, [&](uints, uints b, uints e) {
+                std::move(src + b, src + e, first + b);
+            });
+        }
+    }
+
+    ///Recursively split range in halves, pushing the upper halves as tasks and processing the rest
+    //@param signal active signal to associate the pushed tasks with
+    //@param priority priority of the pushed tasks
+    template <typename Index, typename Fn>
+    void split_range(signal_handle signal, Index first, Index last, uints grain, uints min_grain, const Fn& fn, EPriority priority)
+    {
+        const int owner = get_order();
+
+        while (uints(last - first) > grain) {
+            Index mid = first + (last - first) / 2;
+
+            signal_handle s = signal;
+            push(priority, &s, [this, signal, mid, last, grain, min_grain, owner, &fn, priority]() {
+                uints g = grain;
+                //stolen by another thread, split finer
+                if (get_order() != owner && g > min_grain)
+                    g = g / 2 < min_grain ? min_grain : g / 2;
+                split_range(signal, mid, last, g, min_grain, fn, priority);
+            });
+            DASSERT(s.value == signal.value);
+
+            last = mid;
+        }
+
+        fn(first, last);
+    }
+
+    ///Queue task for processing
+    ///Stamp task with metrics and profiler data before queuing
+    void prepare_task(invoker_base* task, int prio, bool profile)
+    {
+        task->_prio = prio;
+
+#ifdef COID_TASKMASTER_METRICS
+        task->_pushed_ns = metrics_time();
+#endif
+
+        if (profile) {
+            static thread_local profiler::cached_token token("task push");
+            profiler::scope scope(token);
+            task->_link = uint32(profiler::create_transient_link());
+            profiler::push_link(task->_link);
+        }
+    }
+
+    void push_task(invoker_base* task, EPriority priority)
+    {
+        const int prio = (int)priority;
+
+        prepare_task(task, prio, profiler::is_active());
+
+        if (_mode == EScheduling::WORK_STEALING) {
+            const int order = get_order();
+            if (order >= 0 && get_master() == this)
+                _threads[order].deque[prio].push(task);
+            else
+                _ready_jobs[prio].push(task);
+
+            ++_nqueued[prio];
+
+            if (_nsleeping > 0) {
+                //lock so that the notification cannot slip between sleeper's check and wait
+                { std::unique_lock<std::mutex> lock(_sync); }
+
+                //LOW tasks can be processed only by some threads, wake all to get one of those
+                if (priority == EPriority::LOW)
+                    _cv.notify_all();
+                else
+                    _cv.notify_one();
+            }
+        }
+        else {
+            {
+                std::unique_lock<std::mutex> lock(_sync);
+                _ready_jobs[prio].push_front(task);
+                ++_qsize;
+            }
+            _cv.notify_one();
+        }
+    }
+
+    ///Default lead time of a deadline task: half of its remaining budget, at least the deadline window
+    uint64 deadline_lead(uint64 deadline_ns) const
+    {
+        const uint64 now = nsec_timer::current_time_ns();
+        const uint64 lead = deadline_ns > now ? (deadline_ns - now) >> 1 : 0;
+        return lead > _deadline_window ? lead : _deadline_window;
+    }
+
+    void push_deadline_task(invoker_base* task, EPriority priority, uint64 deadline, uint64 urgent)
+    {
+        const int prio = (int)priority;
+
+        prepare_task(task, prio, profiler::is_active());
+
+        _deadlines[prio].push(task, deadline, urgent);
+
+        if (_mode == EScheduling::WORK_STEALING) {
+            ++_ndeadline;
+
+            if (_nsleeping > 0) {
+                //lock so that the notification cannot slip between sleeper's check and wait
+                { std::unique_lock<std::mutex> lock(_sync); }
+
+                if (priority == EPriority::LOW)
+                    _cv.notify_all();
+                else
+                    _cv.notify_one();
+            }
+        }
+        else {
+            {
+                std::unique_lock<std::mutex> lock(_sync);
+                ++_ndeadline;
+                ++_qsize;
+            }
+            _cv.notify_one();
+        }
+    }
+
+    ///Pop the earliest deadline task that became urgent, of any priority, can be run by any thread
+    invoker_base* pop_urgent()
+    {
+        if (_ndeadline <= 0)
+            return 0;
+
+        invoker_base* task = 0;
+        const uint64 now = nsec_timer::current_time_ns();
+
+        int best = -1;
+        uint64 best_urgent = now;
+        for (int prio = 0; prio < (int)EPriority::COUNT; ++prio) {
+            const uint64 u = _deadlines[prio].earliest.load(std::memory_order_relaxed);
+            if (u <= best_urgent) {
+                best = prio;
+                best_urgent = u;
+            }
+        }
+
+        if (best >= 0 && _deadlines[best].pop(task, now)) {
+            --_ndeadline;
+            return task;
+        }
+        return 0;
+    }
+
+    ///Pop deadline task of given priority, deadline tasks go before the regular tasks of the same priority
+    invoker_base* pop_deadline(int prio)
+    {
+        invoker_base* task = 0;
+        if (_ndeadline > 0 && _deadlines[prio].pop(task, UINT64_MAX)) {
+            --_ndeadline;
+            return task;
+        }
+        return 0;
+    }
+
+    //@return time when the earliest queued deadline task becomes urgent, UINT64_MAX if there's none
+    uint64 next_urgent() const
+    {
+        uint64 t = UINT64_MAX;
+        if (_ndeadline > 0) {
+            for (int prio = 0; prio < (int)EPriority::COUNT; ++prio) {
+                const uint64 u = _deadlines[prio].earliest.load(std::memory_order_relaxed);
+                if (u < t)
+                    t = u;
+            }
+        }
+        return t;
+    }
+
+    ///Queue a batch of tasks, waking at most as many sleeping workers as there are tasks
+    void push_tasks(invoker_base* const* tasks, uints count, EPriority priority)
+    {
+        const int prio = (int)priority;
+
+        const bool profile = profiler::is_active();
+        for (uints i = 0; i < count; ++i)
+            prepare_task(tasks[i], prio, profile);
+
+        if (_mode == EScheduling::WORK_STEALING) {
+            const int order = get_order();
+            if (order >= 0 && get_master() == this) {
+                for (uints i = 0; i < count; ++i)
+                    _threads[order].deque[prio].push(tasks[i]);
+            }
+            else
+                _ready_jobs[prio].push(tasks, count);
+
+            _nqueued[prio] += int(count);
+        }
+        else {
+            std::unique_lock<std::mutex> lock(_sync);
+            _ready_jobs[prio].push_front(tasks, count);
+            _qsize += int(count);
+        }
+
+        const int nsleeping = _nsleeping;
+        if (nsleeping <= 0)
+            return;
+
+        //lock so that the notification cannot slip between sleeper's check and wait
+        { std::unique_lock<std::mutex> lock(_sync); }
+
+        //LOW tasks can be processed only by some threads, wake all to get one of those
+        if (priority == EPriority::LOW || count >= uints(nsleeping))
+            _cv.notify_all();
+        else {
+            for (uints i = 0; i < count; ++i)
+                _cv.notify_one();
+        }
+    }
+
+    ///Allocate and queue count tasks created by make(signal, index)
+    template <typename Make>
+    void push_batch(EPriority priority, signal_handle* signal, uints count, Make&& make)
+    {
+        if (!count)
+            return;
+
+        increment(signal, uint(count));
+        const signal_handle handle = signal ? *signal : invalid_signal;
+
+        enum { BATCH = 256 };
+        invoker_base* tasks[BATCH];
+
+        for (uints i = 0; i < count; ) {
+            const uints n = count - i < BATCH ? count - i : BATCH;
+            for (uints k = 0; k < n; ++k)
+                tasks[k] = make(handle, i + k);
+
+            push_tasks(tasks, n, priority);
+            i += n;
+        }
+    }
+
+    ///Get next task to process, own tasks first, then shared queue, then steal from other workers
+    //@return task or nullptr if there's nothing that can be run by this thread
+    invoker_base* pop_task(int order)
+    {
+        invoker_base* task = 0;
+
+        if (_mode != EScheduling::WORK_STEALING) {
+            task = pop_urgent();
+            for (int prio = 0; !task && prio < (int)EPriority::COUNT; ++prio) {
+                if (!can_run(prio, order))
+                    continue;
+                task = pop_deadline(prio);
+                if (!task && !_ready_jobs[prio].pop(task))
+                    task = 0;
+            }
+
+            if (task)
+                --_qsize;
+            return task;
+        }
+
+        //urgent deadline tasks go first
+        task = pop_urgent();
+        if (task)
+            return task;
+
+        threadinfo* self = order >= 0 && get_master() == this ? &_threads[order] : 0;
+        if (!self)
+            order = -1;
+
+        const int nthreads = (int)_threads.size();
+
+        for (int prio = 0; prio < (int)EPriority::COUNT; ++prio)
+        {
+            if (!can_run(prio, order))
+                continue;
+
+            //deadline tasks of this priority, earliest first
+            task = pop_deadline(prio);
+            if (task)
+                return task;
+
+            const bool queued = _nqueued[prio] > 0;
+            bool found = queued && ((self && self->deque[prio].pop(task))
+                || _ready_jobs[prio].pop(task));
+
+            //steal from other workers, starting from the next one
+            //workers on the same NUMA node are tried before remote ones
+            const int first = order >= 0 ? order + 1 : steal_seed();
+            const int npasses = !queued ? 0 : self && _nnodes > 1 ? 2 : 1;
+
+            for (int pass = 0; !found && pass < npasses; ++pass) {
+                for (int i = 0; !found && i < nthreads; ++i) {
+                    int victim = (first + i) % nthreads;
+                    if (victim == order)
+                        continue;
+                    if (npasses > 1 && (_threads[victim].node == self->node) != (pass == 0))
+                        continue;
+
+                    found = _threads[victim].deque[prio].steal(task);
+#ifdef COID_TASKMASTER_METRICS
+                    if (found)
+                        local_stats(order).add(local_stats(order).steals, 1);
+#endif
+                }
+            }
+
+            if (found) {
+                --_nqueued[prio];
+                return task;
+            }
+        }
+
+        return 0;
+    }
+
+    //@return true if there's a queued task that can be run by thread with given order
+    bool has_task(int order) const
+    {
+        for (int prio = 0; prio < (int)EPriority::COUNT; ++prio)
+            if (_nqueued[prio] > 0 && can_run(prio, order))
+                return true;
+
+        if (_ndeadline > 0) {
+            const uint64 now = nsec_timer::current_time_ns();
+            for (int prio = 0; prio < (int)EPriority::COUNT; ++prio)
+                if (_deadlines[prio].count > 0 && (can_run(prio, order) || _deadlines[prio].earliest <= now))
+                    return true;
+        }
+        return false;
+    }
+
+    //@return number of queued tasks
+    int queue_size() const
+    {
+        if (_mode != EScheduling::WORK_STEALING)
+            return _qsize;
+
+        int n = _ndeadline;
+        for (int prio = 0; prio < (int)EPriority::COUNT; ++prio)
+            n += _nqueued[prio];
+        return n;
+    }
+
+    ///Sleep until there's a task this worker can run
+    void idle_wait(int order)
+    {
+        flush_heap();
+
+#ifdef COID_TASKMASTER_METRICS
+        const uint64 t0 = metrics_time();
+#endif
+
+        std::unique_lock<std::mutex> lock(_sync);
+        ++_nsleeping;
+        while (!has_task(order) && !_quitting) {
+            //pending deadline tasks of priorities this worker can't run wake it once they become urgent
+            const uint64 wake = next_urgent();
+            if (wake != UINT64_MAX) {
+                const uint64 now = nsec_timer::current_time_ns();
+                _cv.wait_for(lock, std::chrono::nanoseconds(wake > now ? wake - now : 0));
+            }
+            else
+                _cv.wait(lock);
+        }
+        --_nsleeping;
+
+#ifdef COID_TASKMASTER_METRICS
+        metrics_block& stats = local_stats(order);
+        stats.add(stats.idle_ns, metrics_time() - t0);
+#endif
+    }
+
+    enum {
+        PARK_TIMEOUT_MS = 1,            //< max time parked, bounds the delay when new tasks arrive meanwhile
+    };
+
+    ///Adaptive backoff of a waiting thread that has nothing to do: spin with pause, then yield, then park
+    struct backoff
+    {
+        enum {
+            NSPINS = 10,                //< spin rounds, each doubling the number of pauses
+            NYIELDS = 8,                //< yields after spinning
+        };
+
+        uint step = 0;
+
+        void reset() { step = 0; }
+
+        ///Do the next backoff step
+        //@return true if the thread should park now
+        bool next() {
+            if (step < NSPINS) {
+                for (uint i = 0, n = 1U << step; i < n; ++i)
+                    atomic::cpu_pause();
+            }
+            else if (step < NSPINS + NYIELDS)
+                thread::wait(0);
+            else
+                return true;
+
+            ++step;
+            return false;
+        }
+    };
+
+    ///Park current thread until the signal is triggered or a timeout elapses
+    void park(signal_handle handle)
+    {
+        signal& s = get_signal(handle.index());
+
+        s.nwaiters.fetch_add(1, std::memory_order_seq_cst);
+
+        const uint32 epoch = s.epoch.load(std::memory_order_seq_cst);
+        if (!is_signaled(handle))
+            atomic::futex_wait(&s.epoch, epoch, PARK_TIMEOUT_MS);
+
+        s.nwaiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+#ifdef COID_TASKMASTER_METRICS
+    //@return statistics block of the current thread
+    metrics_block& local_stats(int order) {
+        return order >= 0 && get_master() == this ? _threads[order].stats : _ext_stats;
+    }
+#endif
+
+    static int steal_seed()
+    {
+        static thread_local uint seed = uint(uints(&seed) >> 4);
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return int(seed & 0x7fffffff);
+    }
+
+    void run_task(invoker_base* task, int order)
+    {
 #ifdef _DEBUG
         thread::set_name("<unknown task>"_T);
 #endif
 
-        DASSERT_RET(_taskdata.is_valid_id(id));
-        task->invoke();
+#ifdef COID_TASKMASTER_METRICS
+        metrics_block& stats = local_stats(order);
+        const uint64 t0 = metrics_time();
+        stats.add_latency(task->_prio, t0 - task->_pushed_ns);
+#endif
+
+        const signal_handle handle = task->signal();
+
+        //cancelled tasks are skipped, but still release their signal
+        if (!is_cancelled(handle)) {
+            //tasks can be run nested while waiting, restore the priority of the outer one
+            EPriority& prio = running_priority();
+            const EPriority outer = prio;
+            prio = EPriority(task->_prio);
+
+            if (task->_link) {
+                static thread_local profiler::cached_token token("task");
+                profiler::scope scope(token);
+                profiler::push_link(task->_link);
+                task->invoke();
+            }
+            else
+                task->invoke();
+
+            prio = outer;
+        }
+
+#ifdef COID_TASKMASTER_METRICS
+        stats.add(stats.tasks, 1);
+        stats.add(stats.busy_ns, metrics_time() - t0);
+#endif
 
 #ifdef _DEBUG
         thread::set_name("<no task>"_T);
 #endif
 
-        const signal_handle handle = task->signal();
-        if (handle.is_valid()) {
-            std::unique_lock<std::mutex> lock(_signal_sync);
-            signal& s = _signal_pool[handle.index()];
-            --s.ref;
-            if (s.ref == 0) {
-                s.version = (s.version + 1) % 0xffFF;
-                signal_handle free_handle = signal_handle::make(s.version, handle.index());
-                _free_signals.push(free_handle);
-            }
+        if (handle.is_valid())
+            release_signal(handle);
+
+        free_data(task);
+    }
+
+    signal& get_signal(uint index) const
+    {
+        return _signal_pages[index >> SIGNAL_PAGE_SHIFT][index & (SIGNAL_PAGE_SIZE - 1)];
+    }
+
+    ///Allocate signal with counter set to 1
+    signal_handle alloc_signal()
+    {
+        uint index;
+        while (!pop_free_signal(index)) {
+            if (!grow_signal_pool())
+                return invalid_signal;
         }
 
-        _taskdata.del_range((granule*)task, align_to_chunks(task->size(), sizeof(granule)));
+        signal& s = get_signal(index);
+        const uint version = signal::version(s.state.load(std::memory_order_relaxed));
+        s.state.store(signal::make(version, 1), std::memory_order_release);
+
+        return signal_handle::make(version, index);
     }
 
-    bool is_signaled(signal_handle handle, bool lock)
+    ///Decrement signal counter, release the signal when it reaches 0
+    void release_signal(signal_handle handle)
     {
-        DASSERT_RET(handle.is_valid(), false);
+        signal& s = get_signal(handle.index());
+
+        const uint64 prev = s.state.fetch_sub(1, std::memory_order_acq_rel);
+        DASSERT(signal::version(prev) == handle.version() && signal::ref(prev) > 0);
+
+        if (signal::ref(prev) == 1) {
+            //nobody can increment a signal with zero counter, we are the exclusive owner now
+            continuation* link = s.continuations.exchange(0, std::memory_order_acquire);
+
+            const uint version = (signal::version(prev) + 1) % 0xffFF;
+            s.cancelled.store(signal::no_version, std::memory_order_relaxed);
+            s.state.store(signal::make(version, 0), std::memory_order_release);
+
+            s.epoch.fetch_add(1, std::memory_order_seq_cst);
+            if (s.nwaiters.load(std::memory_order_seq_cst) > 0)
+                atomic::futex_wake_all(&s.epoch);
 
-        signal& s = _signal_pool[handle.index()];
+            push_free_signal(handle.index());
 
-        if (lock) _signal_sync.lock();
-        const uint version = s.version;
-        const uint ref = s.ref;
-        if (lock) _signal_sync.unlock();
+            while (link) {
+                //the task can run and be freed right after being queued
+                continuation* next = link->next;
+                deferred* def = link->owner;
 
-        return version != handle.version() || ref == 0;
+                if (def->npending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    push_task(def->task, def->priority);
+
+                link = next;
+            }
+        }
     }
 
-    signal_handle alloc_signal()
+    ///Add deferred task link to the signal's continuation list
+    //@return false if the signal is already signaled
+    bool add_continuation(signal_handle handle, continuation* link)
     {
-        signal_handle handle;
-        if (!_free_signals.pop(handle)) return invalid_signal;
+        signal& s = get_signal(handle.index());
 
-        signal& s = _signal_pool[handle.index()];
-        s.ref = 1;
+        //take a reference so that the signal can't be released while linking
+        uint64 state = s.state.load(std::memory_order_relaxed);
+        do {
+            if (signal::version(state) != handle.version() || signal::ref(state) == 0)
+                return false;
+        }
+        while (!s.state.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        continuation* head = s.continuations.load(std::memory_order_relaxed);
+        do {
+            link->next = head;
+        }
+        while (!s.continuations.compare_exchange_weak(head, link, std::memory_order_release, std::memory_order_relaxed));
 
-        return handle;
+        release_signal(handle);
+        return true;
     }
 
-    void increment(signal_handle* handle)
+    ///Increment signal counter if the signal is still active, otherwise allocate a new signal
+    void increment(signal_handle* handle, uint count = 1)
     {
-        std::unique_lock<std::mutex> lock(_signal_sync);
         if (!handle) return;
 
         if (handle->is_valid()) {
-            signal& s = _signal_pool[handle->index()];
-            if (is_signaled(*handle, false)) {
-                *handle = alloc_signal();
+            signal& s = get_signal(handle->index());
+            uint64 state = s.state.load(std::memory_order_relaxed);
+
+            while (signal::version(state) == handle->version() && signal::ref(state) > 0) {
+                if (s.state.compare_exchange_weak(state, state + count, std::memory_order_acq_rel, std::memory_order_relaxed))
+                    return;
             }
-            else {
-                ++s.ref;
+        }
+
+        *handle = alloc_signal();
+
+        //new signal is not visible to anyone else yet
+        if (count > 1 && handle->is_valid())
+            get_signal(handle->index()).state.fetch_add(count - 1, std::memory_order_relaxed);
+    }
+
+    ///Lock-free free list of signals, tagged head to avoid ABA
+    bool pop_free_signal(uint& index)
+    {
+        uint64 head = _free_signals.load(std::memory_order_acquire);
+        for (;;) {
+            const uint first = uint(head & 0xffffffffU);
+            if (first == 0)
+                return false;
+
+            const uint next = get_signal(first - 1).next_free.load(std::memory_order_relaxed);
+            const uint64 newhead = ((head >> 32) + 1) << 32 | next;
+
+            if (_free_signals.compare_exchange_weak(head, newhead, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                index = first - 1;
+                return true;
             }
         }
-        else {
-            *handle = alloc_signal();
+    }
+
+    void push_free_signal(uint index)
+    {
+        signal& s = get_signal(index);
+        uint64 head = _free_signals.load(std::memory_order_relaxed);
+        for (;;) {
+            s.next_free.store(uint(head & 0xffffffffU), std::memory_order_relaxed);
+            const uint64 newhead = ((head >> 32) + 1) << 32 | (index + 1);
+
+            if (_free_signals.compare_exchange_weak(head, newhead, std::memory_order_release, std::memory_order_relaxed))
+                return;
         }
     }
 
+    ///Add a page of signals to the pool
+    //@return false if the pool reached the maximum size
+    bool grow_signal_pool()
+    {
+        std::unique_lock<std::mutex> lock(_signal_sync);
+
+        //someone else might have grown it meanwhile
+        if ((_free_signals.load(std::memory_order_acquire) & 0xffffffffU) != 0)
+            return true;
+
+        const uint page = _nsignal_pages;
+        if (page >= MAX_SIGNAL_PAGES)
+            return false;
+
+        signal* p = new signal[SIGNAL_PAGE_SIZE];
+        for (uint i = 0; i < SIGNAL_PAGE_SIZE; ++i) {
+            p[i].state.store(0, std::memory_order_relaxed);
+            p[i].continuations.store(0, std::memory_order_relaxed);
+            p[i].epoch.store(0, std::memory_order_relaxed);
+            p[i].nwaiters.store(0, std::memory_order_relaxed);
+            p[i].cancelled.store(signal::no_version, std::memory_order_relaxed);
+        }
+
+        _signal_pages[page] = p;
+        _nsignal_pages = page + 1;
+
+        const uint base = page << SIGNAL_PAGE_SHIFT;
+        for (uint i = SIGNAL_PAGE_SIZE; i-- > 0; )
+            push_free_signal(base + i);
+
+        return true;
+    }
+
     void notify() {
         {
             std::unique_lock<std::mutex> lock(_sync);
@@ -637,8 +2195,10 @@ private:
 
     void wait() {
         std::unique_lock<std::mutex> lock(_sync);
+        ++_nsleeping;
         while (!_qsize) // handle spurious wake-ups
             _cv.wait(lock);
+        --_nsleeping;
         --_qsize;
     }
 
@@ -654,19 +2214,37 @@ private:
 private:
 
     std::mutex _sync;
+    std::mutex _alloc_sync;
     std::mutex _signal_sync;
     std::condition_variable _cv;
     std::atomic_int _qsize;             //< current queue size, used also as a semaphore
+    std::atomic_int _nsleeping;         //< number of workers sleeping in idle_wait or wait
+    std::atomic_int _nstarted;          //< number of worker threads that entered threadfunc
+    std::atomic_int _nqueued[(int)EPriority::COUNT]; //< number of queued tasks per priority (WORK_STEALING)
+    std::atomic_int _ndeadline;         //< number of queued deadline tasks
+    uint64 _deadline_window;            //< minimum default lead time before deadline when a deadline task becomes urgent
     volatile bool _quitting;
+    EScheduling _mode;
+    uint _nnodes;                       //< number of NUMA nodes workers are spread over
+
+    slotalloc_atomic<granule> _taskdata;  //< shared pool for large tasks
+    dynarray<task_heap*> _heaps;        //< task heaps of non-worker threads, including orphaned ones
+    uint64 _serial;                     //< unique instance id for thread local heap caches
 
-    slotalloc_atomic<granule> _taskdata;
+#ifdef COID_TASKMASTER_METRICS
+    metrics_block _ext_stats;           //< statistics of non-worker threads
+    metrics _published;                 //< state at the last publish_metrics()
+    uint64 _published_ns = 0;
+#endif
 
     dynarray<threadinfo> _threads;
     volatile int _nlowprio_threads;
 
-    dynarray<signal> _signal_pool;
-    dynarray<signal_handle> _free_signals;
+    signal* _signal_pages[MAX_SIGNAL_PAGES]; //< signal pool, grows by pages on demand
+    uint _nsignal_pages;
+    std::atomic<uint64> _free_signals;  //< free list head, tag << 32 | (index + 1)
     queue<invoker_base*> _ready_jobs[(int)EPriority::COUNT];
+    deadline_queue _deadlines[(int)EPriority::COUNT];
 };
 
 COID_NAMESPACE_END
@@ -40,9 +40,70 @@
 #ifndef SYSTYPE_MSVC
 
 #include <sys/time.h>
+#include <time.h>
 
 namespace coid {
 
+uint64 nsec_timer::_freq = 1000000000;
+double  nsec_timer::_freqd = 1e-9;
+
+////////////////////////////////////////////////////////////////////////////////
+nsec_timer::nsec_timer()
+{
+    reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void nsec_timer::reset()
+{
+    _start = current_time_ns();
+    _dtns = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double nsec_timer::time()
+{
+    return time_ns() * 1e-9;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64 nsec_timer::time_ns()
+{
+    return current_time_ns() - _start + _dtns;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64 nsec_timer::current_time_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return uint64(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64 nsec_timer::day_time_ns()
+{
+    static int64 _day_offset = 0;
+
+    if (_day_offset == 0) {
+        uint64 ns = current_time_ns();
+
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+
+        time_t t = tv.tv_sec;
+        struct tm ltm;
+        localtime_r(&t, &ltm);
+
+        uint64 nsc = (tv.tv_sec + ltm.tm_gmtoff) * 1000000000ULL + tv.tv_usec * 1000ULL;
+
+        _day_offset = (nsc % 86400000000000LL) - ns;
+    }
+
+    return current_time_ns() + _day_offset;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 struct timezone tz;
@@ -41,6 +41,7 @@
 #include "alloc/memtrack.h"
 
 #include <type_traits>
+#include <utility>
 
 
 #ifdef SYSTYPE_MSVC